@@ -0,0 +1,101 @@
+#include <MAX6952.h>
+
+// Prints the bus cost of the library calls for chains of 1, 2, 4 .. MAX_CHAIN devices.
+// The numbers come from the counters of the library, no display has to be connected.
+// The costs grow linear with the chain, twice the devices take twice the bytes.
+// The buffer for 64 devices needs about 3kB, use a smaller MAX_CHAIN on small boards.
+//
+// frames   chip-select frames sent
+// bytes    bytes shifted out
+// bus_us   time on the bus at SCK_HZ plus the delays of the library
+// wait_us  time the library waited in delays, with the time between the marquee steps
+// wall_us  time the call took on this board
+//
+// The sketch also runs on a PC, see test/CMakeLists.txt.
+
+#define SCK_HZ          10000000UL
+#define MAX_CHAIN       64
+#define MARQUEE_SPEED   5
+
+byte buffer[DEVICE_BUFFER_SIZE(MAX_CHAIN)];
+
+
+void report(MAX6952 &display, const char *name, unsigned long wall) {
+
+  Serial.print(display.getDeviceCount());
+  Serial.print('\t');
+  Serial.print(name);
+  Serial.print('\t');
+  Serial.print(display.getFrameCount());
+  Serial.print('\t');
+  Serial.print(display.getByteCount());
+  Serial.print('\t');
+  Serial.print(display.getBusMicros(SCK_HZ));
+  Serial.print('\t');
+  Serial.print(display.getBlockingMicros());
+  Serial.print('\t');
+  Serial.println(wall);
+
+  display.resetBusStatistics();
+}
+
+void benchmark(int devices) {
+
+  MAX6952 display = MAX6952(23, 18, 5, devices, buffer);
+  unsigned long start;
+
+  display.setClock(SCK_HZ);
+  display.shutdown(0);
+  display.resetBusStatistics();
+
+  start = micros();
+  display.setIntensity(15);
+  report(display, "setIntensity", micros() - start);
+
+  start = micros();
+  display.setText("MAX6952", LEFT);
+  report(display, "setText", micros() - start);
+
+  start = micros();
+  display.setText("MAX6952", LEFT);
+  report(display, "setText same", micros() - start);
+
+  start = micros();
+  display.setText("NAX6952", LEFT);
+  report(display, "setText 1 char", micros() - start);
+
+  display.setNumber(1234L, 8);
+  display.resetBusStatistics();
+
+  start = micros();
+  display.setNumber(1235L, 8);
+  report(display, "setNumber +1", micros() - start);
+
+  start = micros();
+  display.setTextBlink("MAX6952", 0, CENTER);
+  report(display, "setTextBlink", micros() - start);
+
+  start = micros();
+  display.setTextMarquee("MAX6952", MARQUEE_SPEED, CLASSIC, RIGHT_TO_LEFT);
+  report(display, "setTextMarquee", micros() - start);
+
+  start = micros();
+  display.clearDisplay();
+  report(display, "clearDisplay", micros() - start);
+}
+
+void setup() {
+  // put your setup code here, to run once:
+
+  Serial.begin(115200);
+  Serial.println("devices\tcall\tframes\tbytes\tbus_us\twait_us\twall_us");
+
+  for (int devices = 1; devices <= MAX_CHAIN; devices *= 2) {
+    benchmark(devices);
+  }
+}
+
+void loop() {
+  // put your main code here, to run repeatedly:
+
+}
@@ -1,5 +1,5 @@
 /*
- *    MAX6952.h - A library for controling multiple (max 16) MAX6952
+ *    MAX6952.h - A library for controling multiple MAX6952
  *    Copyright (c) 2019 Kai Krause
  * 
  *    Permission is hereby granted, free of charge, to any person
@@ -24,8 +24,8 @@
  *    OTHER DEALINGS IN THE SOFTWARE.
  */
 
-#include <SPI.h>
 #include "MAX6952.h"
+#include "MAX6952Font.h"
 
 //the opcodes for the MAX6952
 
@@ -39,6 +39,9 @@
 							//  0x06 Not in use
 #define REG_DISPLAYTEST 		0x07
 
+#define FONT_ADDRESS_POINTER	0b10000000	//D7 set in REG_USER_DEFINED_FONTS -> D6..D0 font RAM address
+#define FONT_DATA_MASK			0b01111111	//D7 cleared -> font data, pointer increments
+
 #define REG_P0_BASE 	0x20
 #define REG_D0P0 		0x20
 #define REG_D1P0 		0x21
@@ -62,6 +65,7 @@
 
 												//D1 Not in use
 									
+#define FAST_BLINK_RATE        		0b00000000
 #define SLOW_BLINK_RATE        		0b00000100	//D2 - B -> Blink Rate
 
 #define GLOBAL_BLINK_ENABLE     	0b00001000	//D3 - E -> Global Blink
@@ -78,22 +82,50 @@
 #define BLINK_P1_PHASE_READ_BACK    0b00000000	//D7 - P-> Blink Phase Readback
 #define BLINK_P0_PHASE_READ_BACK    0b10000000
 
-#define	MAX_DEVICES			16
+#define REG_READ			0b10000000	//D15 set -> the register is read back
+
+#define CONFIG_STATE_BITS	(ACTIVE_MODE | SLOW_BLINK_RATE | GLOBAL_BLINK_ENABLE)
+
+#define PLANE0_DIRTY		0x0F	//bits of plane 0 in dirty[]
+#define PLANE1_DIRTY		0xF0	//bits of plane 1 in dirty[]
+
+#define SMOOTH_PITCH		6		//columns per character in the smooth marquee, 5 + 1 blank
+#define SMOOTH_BANKS		(USER_FONT_SLOTS / 4)	//sets of 4 font slots used in turns
+
+#define DEFAULT_FRAME_GUARD	1		//microseconds CS stays high after a frame
+#define DEFAULT_FLIP_DELAY	500		//milliseconds of the P0 phase, fast blink at 4MHz OSC
 #define DEBUG				0
 #define DEBUG_LVL_2			0	
 
 
 
-MAX6952::MAX6952(int dataPin, int clkPin, int csPin, int numDevices) {
+MAX6952::MAX6952(int /*dataPin*/, int /*clkPin*/, int csPin, int numDevices, byte *buffer) : hardwareSPI(csPin) {
+	
+	transport = NULL;
+	init(numDevices, buffer);
+}
+
+MAX6952::MAX6952(MAX6952Transport &chainTransport, int numDevices, byte *buffer) : hardwareSPI(-1) {
+	
+	transport = &chainTransport;
+	init(numDevices, buffer);
+}
+
+MAX6952Transport *MAX6952::bus() {
+	
+	if(transport == NULL){
+		return &hardwareSPI;
+	}
 	
+	return transport;
+}
+
+void MAX6952::init(int numDevices, byte *buffer) {
 	
 	if(DEBUG){
 		Serial.println("Konstruktor");
 		
 	}
-	SPI_MOSI	=	dataPin;
-    SPI_CLK		=	clkPin;
-    SPI_CS		=	csPin;
     
 	if(numDevices <= 0){
 		numDevices = 1;
@@ -103,17 +135,65 @@ MAX6952::MAX6952(int dataPin, int clkPin, int csPin, int numDevices) {
 		numDevices = MAX_DEVICES;
 	}
 	
-	SPI.begin();
+	bus()->begin();
+	
+	if(buffer == NULL){
+		buffer = (byte*)malloc(DEVICE_BUFFER_SIZE(numDevices));
+	}
+	
+	if(buffer == NULL){
+		
+		if(DEBUG){
+			Serial.println("No memory for the buffer");
+		}
+		
+		numDevices = 0;
+	}
         
    	maxDevices = numDevices;
 	maxTextLength = maxDevices * 4;
 	
-    pinMode(SPI_MOSI,OUTPUT);
-    pinMode(SPI_CLK,OUTPUT);
-    pinMode(SPI_CS,OUTPUT);
-   
-   
+	status		=	buffer;
+	dirty		=	status + (maxDevices * 8);
+	frame		=	dirty + maxDevices;
+	queue		=	frame + (maxDevices * 2);
+	queueCount	=	queue + (maxDevices * MAX_QUEUE_DEPTH * 2);
+	config		=	queueCount + maxDevices;
+	intensity	=	config + maxDevices;
+	fontAddress	=	intensity + (maxDevices * 2);
+	blinkMask	=	fontAddress + maxDevices;
+	presented	=	blinkMask + maxDevices;
+	
+	marquee.running = false;
+	smoothBudget = 0;
+	shadowChanges = 0;
+	setMarqueeCache(NULL, 0);
+	refreshInterval = 0;
+	schedule.pending = false;
+	schedule.started = false;
+	frameGuard = DEFAULT_FRAME_GUARD;
+	frameCallback = NULL;
+	resetBusStatistics();
+	memset(queueCount, 0, maxDevices);
+	queueFrames = 0;
+	queueSent = 0;
+	/* The devices start active, the clear below sends it. Only shutdown()
+	 * turns them off. */
+	memset(config, ACTIVE_MODE, maxDevices);
+	memset(intensity, 0x00, maxDevices * 2);
+	memset(fontAddress, 0xFF, maxDevices);
+	memset(blinkMask, 0, maxDevices);
+	fade.running = false;
+	flip.running = false;
+	phaseReadBack = false;
+	doubleBuffer = false;
+	textBlink = false;
+	flipDelay = DEFAULT_FLIP_DELAY;
+	fontCache = NULL;
+	
     setRegister(REG_SCANLIMIT,0x01);
+	setRegister(REG_INTENSITY_10,0x00);
+	setRegister(REG_INTENSITY_32,0x00);
 	clearDisplay();
 	setRegister(REG_DISPLAYTEST,0x01);
 	delay(1000);
@@ -129,826 +209,1666 @@ int MAX6952::getDeviceCount() {
 
 void MAX6952::setRegister(byte addr, byte data){
 	
-	digitalWrite(SPI_CS, LOW);
- 
-	 
-	 for(int i=1;i<(maxDevices +1);i++){
-		
-		if(DEBUG_LVL_2){
-			Serial.print("Max6952 No: ");
-			Serial.println(i);
-		}
-		
-		SPI.transfer(addr);
-		SPI.transfer(data);
-		 
+	sendQueue();
+	
+	for(int i = 0; i < maxDevices; i++){
+		frame[i * 2] = addr;
+		frame[(i * 2) + 1] = data;
 	}
 	
-	digitalWrite(SPI_CS, HIGH);
-	delay(1);	
-}
-
-int MAX6952::getMaxTextLength() {
-	return maxTextLength;
+	writeFrame();
 }
 
-void MAX6952::shutdown(bool b) {
-    
-    if(b){
-		if(DEBUG){
-			Serial.println("Shutdown Display");
+bool MAX6952::writeFrame(bool receive){
+	
+	if(DEBUG_LVL_2){
+		for(int i = 0; i < maxDevices; i++){
+			Serial.print("Max6952 No: ");
+			Serial.print(maxDevices - i);
+			Serial.print(" Addr: ");
+			Serial.print(frame[i * 2]);
+			Serial.print(" ->");
+			Serial.println(frame[(i * 2) + 1]);
 		}
-		setRegister(REG_CONFIGURATION, SHUTDOWN_MODE);
 	}
-        
-    else{
-		if(DEBUG){
-			Serial.println("Activate Display");
+	
+	if(frameCallback != NULL){
+		frameCallback(frame, maxDevices * 2);
+	}
+	
+	frameCount++;
+	byteCount += maxDevices * 2;
+	
+	/* The bus may change the frame, so it is recorded before */
+	if(marqueeCache.capture){
+		
+		if(marqueeCache.used + (maxDevices * 2) <= marqueeCache.size){
+			memcpy(&marqueeCache.buffer[marqueeCache.used], frame, maxDevices * 2);
+			marqueeCache.used += maxDevices * 2;
+		} else {
+			marqueeCache.overflow = true;
 		}
-		setRegister(REG_CONFIGURATION, ACTIVE_MODE);
 	}
-       
+	
+	bool received = false;
+	
+	if(receive){
+		received = bus()->read(frame, maxDevices * 2);
+	} else {
+		bus()->write(frame, maxDevices * 2);
+	}
+	
+	/*
+	 * The data is latched on the rising edge of CS. The datasheet only asks
+	 * for some nanoseconds of CS high time (tCSW) before the next frame,
+	 * the guard keeps a margin for slow level shifters and long cables.
+	 */
+	if(frameGuard > 0){
+		delayMicroseconds(frameGuard);
+		blockingMicros += frameGuard;
+	}
+	
+	return received;
 }
 
+void MAX6952::setRegister(int device, byte addr, byte data){
+	
+	queueRegister(device, addr, data);
+	sendQueue();
+}
 
-void MAX6952::setIntensity(int intensity) {
-    
+void MAX6952::queueRegister(int device, byte addr, byte data){
 	
-	if(intensity<=0){
-		intensity = 1;
+	if(device == ALL_DEVICES){
+		for(int i = 0; i < maxDevices; i++){
+			queueRegister(i, addr, data);
+		}
+		return;
 	}
 	
-	if(intensity>15){
-		intensity = 15;
+	if(device < 0 || device >= maxDevices){
+		return;
 	}
-		
-	/*
-	 * This function sets the same intensity to all digits
-	 * The intensity is set in the both registers Intensity10 and Intensity32
- 
-	 * The lower  4 bit of Intensity10 are the intesity for Digit0
-	 * The higher 4 bit of Intensity10 are the intesity for Digit1
-	 * The lower  4 bit of Intensity32 are the intesity for Digit2
-	 * The higher 4 bit of Intensity32 are the intesity for Digit3
-	 */
- 
-	intensity = (intensity & 0x0f) + ((intensity & 0x0f)<<4);
 	
-	if(DEBUG){
-		Serial.println("SetIntensity");
+	/* A queue which is partly sent is finished first, so no write is skipped */
+	if(queueSent > 0 || queueCount[device] >= MAX_QUEUE_DEPTH){
+		sendQueue();
 	}
 	
-	setRegister(REG_INTENSITY_10,intensity);
-	setRegister(REG_INTENSITY_32,intensity);
- 	
+	byte *entry = &queue[((device * MAX_QUEUE_DEPTH) + queueCount[device]) * 2];
+	entry[0] = addr;
+	entry[1] = data;
+	queueCount[device]++;
+	
+	if(queueCount[device] > queueFrames){
+		queueFrames = queueCount[device];
+	}
 }
 
-void MAX6952::clearDisplay() {
-    
-	if(DEBUG){
-		Serial.println("Clear Display");
-	}
-	setRegister(REG_CONFIGURATION, GLOBAL_CLEAR_DIGIT_DATA);
+void MAX6952::sendQueue(){
 	
+	while(sendQueueFrame()){
+	}
 }
 
-void MAX6952::writeDisplay(char * deviceBuffer) {
+bool MAX6952::sendQueueFrame(){
 	
-	if(maxDevices == 1){
+	/*
+	 * Frame k carries the k-th queued write of every device,
+	 * devices with less writes get a NOOP.
+	 */
+	if(queueSent < queueFrames){
 		
-		if(DEBUG_LVL_2){
-			Serial.println("Nur ein Max6952");
-		}
+		int k = queueSent;
 		
-		for(int i = 1;i < 5;i++){
-			
-		   
-		    digitalWrite(SPI_CS, LOW);
-		   
-			if(DEBUG_LVL_2){
-				Serial.println("LOW");
-				Serial.print("Device:");
-				Serial.print(1);
-				Serial.print(" Digit:");
-				Serial.print(4-i);
-				Serial.print(" Addr: ");
-				Serial.print(REG_P0P1_BASE + (4-i) );
-				Serial.print(" ->");
-				Serial.print(deviceBuffer[(1*4)-i]);
-				Serial.println("");
-			}
+		for(int j = 0; j < maxDevices; j++){
 			
-		    
-			SPI.transfer(REG_P0P1_BASE + (4-i) );
-			SPI.transfer(deviceBuffer[(1*4)-i]);
-
+			byte *slot = &frame[(maxDevices - 1 - j) * 2];
 			
-		    if(DEBUG_LVL_2){
-				Serial.println("HIGH");
+			if(k < queueCount[j]){
+				byte *entry = &queue[((j * MAX_QUEUE_DEPTH) + k) * 2];
+				slot[0] = entry[0];
+				slot[1] = entry[1];
+			} else {
+				slot[0] = NOOP;
+				slot[1] = 0x00;
 			}
-			
-		    digitalWrite(SPI_CS, HIGH);
-		    delay(1);
-        }
-	} else {
-		
-		
-		if(DEBUG_LVL_2){
-			Serial.println("Mehrere Max6952");
 		}
 		
-		for(int i = 1;i < 5;i++){
-			
-			digitalWrite(SPI_CS, LOW);
-			
-			if(DEBUG_LVL_2){
-				Serial.println("LOW");
-			}
-			
-			for(int j = maxDevices; j > 0 ;j--){
-			
-			if(DEBUG_LVL_2){
-				Serial.print("Device:");
-				Serial.print(j);
-				Serial.print(" Digit:");
-				Serial.print(4-i);
-				Serial.print(" Addr: ");
-				Serial.print(REG_P0P1_BASE + (4-i) );
-				Serial.print(" ->");
-				Serial.print(deviceBuffer[(j*4)-i]);
-				Serial.println("");
-			}
-			
-			SPI.transfer(REG_P0P1_BASE + (4-i) );
-			SPI.transfer(deviceBuffer[(j*4)-i]);
-			
-			}
-			
-			
-			if(DEBUG_LVL_2){
-				Serial.println("HIGH");
-			}
-			
-			digitalWrite(SPI_CS, HIGH);
-			delay(1);
-		}
+		writeFrame();
+		queueSent++;
 	}
 	
+	if(queueSent < queueFrames){
+		return true;
+	}
 	
+	memset(queueCount, 0, maxDevices);
+	queueFrames = 0;
+	queueSent = 0;
 	
-	
+	return false;
+}
+
+void MAX6952::setFrameGuard(unsigned int microseconds){
+	frameGuard = microseconds;
+}
+
+void MAX6952::setClock(unsigned long hz){
+	bus()->setClock(hz);
+}
+
+void MAX6952::setFrameCallback(void (*callback)(const byte *frame, int length)){
+	frameCallback = callback;
+}
+
+unsigned long MAX6952::getFrameCount(){
+	return frameCount;
+}
+
+unsigned long MAX6952::getByteCount(){
+	return byteCount;
+}
+
+unsigned long MAX6952::getBlockingMicros(){
+	return blockingMicros;
 }
 
-void MAX6952::setText(String inputText, int position){
+unsigned long MAX6952::getBusMicros(unsigned long sckHz){
 	
-	if(DEBUG){
-		Serial.println("Set Text");
-	}
+	unsigned long clocks = byteCount * 8UL;
+	unsigned long kHz = sckHz / 1000UL;
 	
-	clearDisplay();
-	setRegister(REG_CONFIGURATION,SLOW_BLINK_RATE + ACTIVE_MODE + GLOBAL_BLINK_DISABLE+GLOBAL_BLINK_TIMING_SYNC);
+	if(kHz == 0){
+		return blockingMicros;
+	}
 	
-	String outputText ="";
+	/* Whole milliseconds and the rest separately, so clocks * 1000 can not overflow */
+	return ((clocks / kHz) * 1000UL) + (((clocks % kHz) * 1000UL) / kHz) + blockingMicros;
+}
+
+void MAX6952::resetBusStatistics(){
+	frameCount = 0;
+	byteCount = 0;
+	blockingMicros = 0;
+	coalescedCount = 0;
+}
+
+int MAX6952::getMaxTextLength() {
+	return maxTextLength;
+}
+
+void MAX6952::shutdown(bool b) {
+    
+	shutdown(ALL_DEVICES, b);
+}
 
+void MAX6952::shutdown(int device, bool b) {
+    
+    if(DEBUG){
+		Serial.print(b ? "Shutdown Device: " : "Activate Device: ");
+		Serial.println(device);
+	}
 	
-	char deviceBuffer[maxTextLength];
- 
-	memset(deviceBuffer,0x00,sizeof(deviceBuffer));
- 
-	if(maxTextLength > inputText.length()) {
+	for(int i = 0; i < maxDevices; i++){
 		
-		if(DEBUG){
-			Serial.println("Input < Display");
+		if(device != ALL_DEVICES && device != i){
+			continue;
 		}
 		
-		switch(position){
-			case LEFT:
-			{
-				if(DEBUG){
-					Serial.println("Left");
-				}
-				
-				outputText = inputText;
-   				for(int i = 0; i < (maxTextLength - inputText.length());i++){
-					outputText.concat(" ");
-				}
-				break;
-			}
-			
-			case RIGHT:
-			{
-				if(DEBUG){
-					Serial.println("Right");
-				}
-				
-				for(int i = 0; i < (maxTextLength - inputText.length());i++){
-				outputText.concat(" ");
-				}
-				outputText.concat(inputText);
-				break;
-			}
-			
-			case CENTER:
-			{
-				if(DEBUG){
-					Serial.println("Center");
-				}
-			
-				int frontSpaces = (maxTextLength - inputText.length()) / 2;
-								
-				for(int i = 0; i < (frontSpaces);i++){
-					outputText.concat(" ");
-				}
-				outputText.concat(inputText);
-				
-				
-				for(int i = 0; i < (maxTextLength - inputText.length() - frontSpaces );i++){
-					outputText.concat(" ");
-				}
-				break;
-			}
-			
-			default:
-			{
-				if(DEBUG){
-					Serial.println("Default: Left");
-				}
-				
-				outputText = inputText;
-   				for(int i = 0; i < (maxTextLength - inputText.length());i++){
-					outputText.concat(" ");
-				}
-			
-				break;
-			}	
+		if(b){
+			queueConfig(i, config[i] & ~ACTIVE_MODE);
+		} else {
+			queueConfig(i, config[i] | ACTIVE_MODE);
 		}
-		
-		outputText.getBytes((byte*)deviceBuffer,sizeof(deviceBuffer)+1);
-		
-		
-		if(DEBUG){
-			Serial.print("MaxTextLength:");
-			Serial.print(maxTextLength);
-			Serial.print(" InputTextLength:");
-			Serial.println(inputText.length());
-			Serial.print("Input Text >");
-			Serial.print(inputText);
-			Serial.print("< Output Text >");
-			Serial.print(deviceBuffer);
-			Serial.println("<");
+	}
+	
+	sendQueue();
+}
+
+void MAX6952::queueConfig(int device, byte value) {
+	
+	if(device == ALL_DEVICES){
+		for(int i = 0; i < maxDevices; i++){
+			queueConfig(i, value);
 		}
+		return;
+	}
+	
+	/* Timing sync and clear are actions, they are not kept */
+	config[device] = value & CONFIG_STATE_BITS;
+	queueRegister(device, REG_CONFIGURATION, value);
+}
 
+void MAX6952::updateConfig(byte mask, byte bits) {
+	
+	for(int i = 0; i < maxDevices; i++){
 		
-   
-	} else {
-		
-		if(DEBUG){
-			Serial.println("Input > Display");
-		}
+		byte value = (config[i] & ~mask) | bits;
 		
-		inputText.getBytes((byte*)deviceBuffer,sizeof(deviceBuffer)+1);
-	   
-		if(DEBUG){
-			Serial.print("MaxTextLength:");
-			Serial.print(maxTextLength);
-			Serial.print(" InputTextLength:");
-			Serial.println(inputText.length());
-			Serial.print("Input Text >");
-			Serial.print(inputText);
-			Serial.print("< Output Text >");
-			Serial.print(deviceBuffer);
-			Serial.println("<");
+		if(value != config[i]){
+			queueConfig(i, value);
 		}
-
-		
 	}
- 
-  
- 
-  
+	
+	sendQueue();
+}
 
-	if(maxDevices == 1){
-		
-		if(DEBUG){
-			Serial.println("Nur ein Max6952");
-		}
-		
-		for(int i = 1;i < 5;i++){
-			
-		   
-		    digitalWrite(SPI_CS, LOW);
-		   
-			if(DEBUG){
-				Serial.println("LOW");
-				Serial.print("Device:");
-				Serial.print(1);
-				Serial.print(" Digit:");
-				Serial.print(4-i);
-				Serial.print(" Addr: ");
-				Serial.print(REG_P0P1_BASE + (4-i) );
-				Serial.print(" ->");
-				Serial.print(deviceBuffer[(1*4)-i]);
-				Serial.println("");
-			}
-			
-		    
-			SPI.transfer(REG_P0P1_BASE + (4-i) );
-			SPI.transfer(deviceBuffer[(1*4)-i]);
+void MAX6952::activateSteady() {
+	
+	/* A device which was shut down stays shut down */
+	textBlink = false;
+	updateConfig(GLOBAL_BLINK_ENABLE, GLOBAL_BLINK_DISABLE);
+}
 
-		  
-		    if(DEBUG){
-				Serial.println("HIGH");
-			}
-			
-		    digitalWrite(SPI_CS, HIGH);
-		    delay(1);
-        }
-	} else {
+void MAX6952::activateBlink(byte rate, bool sync) {
+	
+	bool changed = sync;
+	
+	for(int i = 0; i < maxDevices; i++){
 		
-		if(DEBUG){
-			Serial.println("Mehrere Max6952");
-		}
+		byte value = (config[i] & ~SLOW_BLINK_RATE) | GLOBAL_BLINK_ENABLE | rate;
 		
-		for(int i = 1;i < 5;i++){
-			
-			digitalWrite(SPI_CS, LOW);
-			
-			if(DEBUG){
-				Serial.println("LOW");
-			}
-    
-			for(int j = maxDevices; j > 0 ;j--){
-
-			if(DEBUG){
-				Serial.print("Device:");
-				Serial.print(j);
-				Serial.print(" Digit:");
-				Serial.print(4-i);
-				Serial.print(" Addr: ");
-				Serial.print(REG_P0P1_BASE + (4-i) );
-				Serial.print(" ->");
-				Serial.print(deviceBuffer[(j*4)-i]);
-				Serial.println("");
-			}
-			
-			SPI.transfer(REG_P0P1_BASE + (4-i) );
-			SPI.transfer(deviceBuffer[(j*4)-i]);
-    
-			}
-			if(DEBUG){
-				Serial.println("HIGH");
-			}
-			
-			digitalWrite(SPI_CS, HIGH);
-			delay(1);
+		if(value != config[i]){
+			changed = true;
 		}
 	}
-  
- 
 	
+	if(!changed){
+		return;
+	}
+	
+	/*
+	 * All devices get the configuration with the T bit in the same frame,
+	 * so their blink starts at the same time. A blink which is already
+	 * running is not synchronized again, that would restart its phase.
+	 */
+	sendQueue();
+	
+	for(int i = 0; i < maxDevices; i++){
+		byte value = (config[i] & ~SLOW_BLINK_RATE) | GLOBAL_BLINK_ENABLE | rate;
+		queueConfig(i, value | GLOBAL_BLINK_TIMING_SYNC);
+	}
 	
+	sendQueue();
 }
 
-
-void MAX6952::setTextBlink(String inputText,int speed, int position){
+void MAX6952::activateText() {
 	
-	if(DEBUG){
-		Serial.println("Set Text Blink");
+	textBlink = false;
+	
+	for(int i = 0; i < maxDevices; i++){
+		
+		/* A digit with a blink mask needs the global blink */
+		if(blinkMask[i] != 0){
+			activateBlink(config[i] & SLOW_BLINK_RATE, false);
+			return;
+		}
 	}
 	
-	String outputText ="";
+	activateSteady();
+}
 
-	//clearDisplay();
-	setRegister(REG_CONFIGURATION,ACTIVE_MODE + GLOBAL_BLINK_ENABLE);
+void MAX6952::setDigitBlink(int position, bool blink, int count) {
 	
+	if(DEBUG){
+		Serial.println("Set Digit Blink");
+	}
 	
+	/*
+	 * A blinking character is blank in plane 1 and shown in plane 0,
+	 * a steady one has the same character in both planes. Only the
+	 * digits whose mask changes are touched, the others may show plane 1
+	 * of setTextBlink().
+	 */
+	bool changed = false;
 	
-	char deviceBuffer[maxTextLength];
- 
-	memset(deviceBuffer,0x00,sizeof(deviceBuffer));
- 
-	if(maxTextLength > inputText.length()) {
-		
-		if(DEBUG){
-			Serial.println("Input < Display");
-		}
+	for(int i = position; i < position + count; i++){
 		
-		switch(position){
-			case LEFT:
-			{
-				if(DEBUG){
-					Serial.println("Left");
-				}
-				
-				outputText = inputText;
-   				for(int i = 0; i < (maxTextLength - inputText.length());i++){
-					outputText.concat(" ");
-				}
-				break;
-			}
-			
-			case RIGHT:
-			{
-				if(DEBUG){
-					Serial.println("Right");
-				}
-				
-				for(int i = 0; i < (maxTextLength - inputText.length());i++){
-				outputText.concat(" ");
-				}
-				outputText.concat(inputText);
-				break;
-			}
-			
-			case CENTER:
-			{
-				if(DEBUG){
-					Serial.println("Center");
-				}
-			
-				int frontSpaces = (maxTextLength - inputText.length()) / 2;
-								
-				for(int i = 0; i < (frontSpaces);i++){
-					outputText.concat(" ");
-				}
-				outputText.concat(inputText);
-				
-				
-				for(int i = 0; i < (maxTextLength - inputText.length() - frontSpaces );i++){
-					outputText.concat(" ");
-				}
-				break;
-			}
-			
-			default:
-			{
-				if(DEBUG){
-					Serial.println("Default: Left");
-				}
-				
-				outputText = inputText;
-   				for(int i = 0; i < (maxTextLength - inputText.length());i++){
-					outputText.concat(" ");
-				}
-			
-				break;
-			}	
+		if(i < 0 || i >= maxTextLength){
+			continue;
 		}
 		
-		outputText.getBytes((byte*)deviceBuffer,sizeof(deviceBuffer)+1);
+		byte bit = 1 << (i % 4);
 		
+		if(((blinkMask[i / 4] & bit) != 0) == blink){
+			continue;
+		}
 		
-		if(DEBUG){
-			Serial.print("MaxTextLength:");
-			Serial.print(maxTextLength);
-			Serial.print(" InputTextLength:");
-			Serial.println(inputText.length());
-			Serial.print("Input Text >");
-			Serial.print(inputText);
-			Serial.print("< Output Text >");
-			Serial.print(deviceBuffer);
-			Serial.println("<");
+		if(blink){
+			blinkMask[i / 4] |= bit;
+		} else {
+			blinkMask[i / 4] &= ~bit;
 		}
+		
+		/* putChar() blanks plane 1 by the mask */
+		putChar(i, 1, status[i]);
+		changed = true;
+	}
+	
+	if(!changed || doubleBuffer){
+		return;
+	}
+	
+	/* Plane 1 is ready before the blink starts */
+	flush();
+	
+	/* The blink of setTextBlink() keeps running */
+	if(textBlink){
+		return;
+	}
+	
+	activateText();
+}
+
+void MAX6952::syncBlink() {
+	
+	if(DEBUG){
+		Serial.println("Sync Blink");
+	}
+	
+	sendQueue();
+	
+	for(int i = 0; i < maxDevices; i++){
+		queueConfig(i, config[i] | GLOBAL_BLINK_TIMING_SYNC);
+	}
+	
+	sendQueue();
+}
+
+void MAX6952::setPhaseReadBack(bool on) {
+	phaseReadBack = on;
+}
+
+int MAX6952::getBlinkPhase() {
+	
+	if(!phaseReadBack){
+		return -1;
+	}
+	
+	sendQueue();
+	
+	/*
+	 * The read command goes to the last device, its DOUT is connected to
+	 * MISO. The device shifts the configuration out in the next frame,
+	 * ahead of the NOOPs of this frame.
+	 */
+	memset(frame, NOOP, maxDevices * 2);
+	frame[0] = REG_READ | REG_CONFIGURATION;
+	writeFrame();
+	
+	memset(frame, NOOP, maxDevices * 2);
+	
+	if(!writeFrame(true)){
+		return -1;
+	}
+	
+	return (frame[1] & BLINK_P0_PHASE_READ_BACK) ? 0 : 1;
+}
+
+
+void MAX6952::setIntensity(int intensity) {
+    
+	if(DEBUG){
+		Serial.println("SetIntensity");
+	}
+	
+	setIntensity(ALL_DEVICES, ALL_DIGITS, intensity);
+}
+
+void MAX6952::setIntensity(int device, int digit, int level) {
+    
+	
+	/* 0 is the lowest intensity (1/16), the display is not switched off */
+	if(level<0){
+		level = 0;
+	}
+	
+	if(level>15){
+		level = 15;
+	}
+	
+	if(device == ALL_DEVICES){
+		for(int i = 0; i < maxDevices; i++){
+			queueIntensity(i, digit, level);
+		}
+	} else if(device >= 0 && device < maxDevices){
+		queueIntensity(device, digit, level);
+	}
+	
+	sendQueue();
+}
+
+void MAX6952::queueIntensity(int device, int digit, int level) {
+		
+	/*
+	 * The intensity is set in the both registers Intensity10 and Intensity32
+ 
+	 * The lower  4 bit of Intensity10 are the intesity for Digit0
+	 * The higher 4 bit of Intensity10 are the intesity for Digit1
+	 * The lower  4 bit of Intensity32 are the intesity for Digit2
+	 * The higher 4 bit of Intensity32 are the intesity for Digit3
+	 */
+	if(digit != ALL_DIGITS && (digit < 0 || digit > 3)){
+		return;
+	}
+	
+	for(int i = 0; i < 2; i++){
+		
+		byte *reg = &intensity[(device * 2) + i];
+		byte value = *reg;
+		
+		for(int d = i * 2; d < (i * 2) + 2; d++){
+			
+			if(digit == ALL_DIGITS || digit == d){
+				int shift = (d % 2) * 4;
+				value = (value & ~(0x0f << shift)) | ((level & 0x0f) << shift);
+			}
+		}
+		
+		/* Only registers which change are sent */
+		if(value != *reg){
+			*reg = value;
+			queueRegister(device, (i == 0) ? REG_INTENSITY_10 : REG_INTENSITY_32, value);
+		}
+	}
+}
+
+void MAX6952::setDigitIntensity(int position, int level) {
+	
+	if(position < 0 || position >= maxTextLength){
+		return;
+	}
+	
+	setIntensity(position / 4, position % 4, level);
+}
+
+void MAX6952::fadeIntensity(int device, int from, int to, unsigned long duration) {
+	
+	if(DEBUG){
+		Serial.println("Fade Intensity");
+	}
+	
+	fade.device = device;
+	fade.from = from;
+	fade.to = to;
+	fade.duration = duration;
+	fade.started = false;
+	fade.running = true;
+}
+
+bool MAX6952::updateFade(unsigned long now) {
+	
+	if(!fade.running){
+		return false;
+	}
+	
+	if(!fade.started){
+		fade.start = now;
+		fade.started = true;
+	}
+	
+	unsigned long elapsed = now - fade.start;
+	int level = fade.to;
+	
+	if(elapsed < fade.duration){
+		level = fade.from + (int)(((long)(fade.to - fade.from) * (long)elapsed) / (long)fade.duration);
+	} else {
+		fade.running = false;
+	}
+	
+	/* Nothing is sent while the level does not change */
+	setIntensity(fade.device, ALL_DIGITS, level);
+	
+	return fade.running;
+}
+
+bool MAX6952::isFading() {
+	return fade.running;
+}
 
+void MAX6952::setFontCache(byte *cache) {
+	
+	fontCache = cache;
+	invalidateUserFont();
+}
+
+void MAX6952::invalidateUserFont() {
+	
+	/* A byte with D7 set is never written as font data, so it marks an unknown column */
+	if(fontCache != NULL){
+		memset(fontCache, 0xFF, FONT_CACHE_SIZE(maxDevices));
+	}
+	
+	memset(fontAddress, 0xFF, maxDevices);
+}
+
+int MAX6952::setUserFont(int device, int slot, const byte *glyphs, int count) {
+	
+	if(DEBUG){
+		Serial.println("Set User Font");
+	}
+	
+	if(slot < 0 || device < ALL_DEVICES || device >= maxDevices){
+		return 0;
+	}
+	
+	if(slot + count > USER_FONT_SLOTS){
+		count = USER_FONT_SLOTS - slot;
+	}
+	
+	int sent = 0;
+	
+	/*
+	 * One glyph is sent to all devices in the same frames. The pointer is
+	 * only written when the device does not already point to the glyph,
+	 * the device increments it for every column. Devices which already
+	 * have the glyph get NOOPs.
+	 */
+	for(int g = 0; g < count; g++){
+		
+		const byte *glyph = &glyphs[g * USER_FONT_COLUMNS];
+		
+		for(int j = 0; j < maxDevices; j++){
+			
+			if(device != ALL_DEVICES && device != j){
+				continue;
+			}
+			
+			if(queueGlyph(j, slot + g, glyph)){
+				sent++;
+			}
+		}
+		
+		sendQueue();
+	}
+	
+	return sent;
+}
+
+bool MAX6952::queueGlyph(int device, int slot, const byte *glyph) {
+	
+	int address = slot * USER_FONT_COLUMNS;
+	byte *cached = NULL;
+	
+	if(fontCache != NULL){
+		
+		cached = &fontCache[(device * USER_FONT_SLOTS * USER_FONT_COLUMNS) + address];
+		
+		bool resident = true;
+		
+		for(int c = 0; c < USER_FONT_COLUMNS; c++){
+			if(cached[c] != (glyph[c] & FONT_DATA_MASK)){
+				resident = false;
+			}
+		}
+		
+		if(resident){
+			return false;
+		}
+	}
+	
+	if(fontAddress[device] != address){
+		queueRegister(device, REG_USER_DEFINED_FONTS, FONT_ADDRESS_POINTER | address);
+	}
+	
+	fontAddress[device] = address + USER_FONT_COLUMNS;
+	
+	for(int c = 0; c < USER_FONT_COLUMNS; c++){
+		
+		queueRegister(device, REG_USER_DEFINED_FONTS, glyph[c] & FONT_DATA_MASK);
+		
+		if(cached != NULL){
+			cached[c] = glyph[c] & FONT_DATA_MASK;
+		}
+	}
+	
+	return true;
+}
+
+int MAX6952::findGlyph(int device, const byte *glyph) {
+	
+	if(fontCache == NULL){
+		return -1;
+	}
+	
+	for(int slot = 0; slot < USER_FONT_SLOTS; slot++){
+		
+		const byte *cached = &fontCache[((device * USER_FONT_SLOTS) + slot) * USER_FONT_COLUMNS];
+		
+		if(memcmp(cached, glyph, USER_FONT_COLUMNS) == 0){
+			return slot;
+		}
+	}
+	
+	return -1;
+}
+
+void MAX6952::clearDisplay() {
+    
+	if(DEBUG){
+		Serial.println("Clear Display");
+	}
+	
+	finishFlip();
+	
+	/* The clear is sent with the state of each device, so shutdown and blink stay */
+	for(int i = 0; i < maxDevices; i++){
+		queueConfig(i, config[i] | GLOBAL_CLEAR_DIGIT_DATA);
+	}
+	
+	sendQueue();
+	
+	/*
+	 * The shadow does not know what the devices show after the clear,
+	 * so all digits are sent again with the next flush.
+	 */
+	memset(status, ' ', maxTextLength * 2);
+	memset(dirty, 0xFF, maxDevices);
+	shadowChanges++;
+	
+}
+
+void MAX6952::putChar(int position, int plane, byte c) {
+	
+	int index = (plane * maxTextLength) + position;
+	
+	/* Plane 1 of a character with a blink mask stays blank */
+	if(plane == 1 && (blinkMask[position / 4] & (1 << (position % 4)))){
+		c = ' ';
+	}
+	
+	if(status[index] != c){
+		status[index] = c;
+		shadowChanges++;
+		dirty[position / 4] |= 1 << ((plane * 4) + (position % 4));
+	}
+}
+
+void MAX6952::setChar(int position, char c) {
+	
+	if(position < 0 || position >= maxTextLength){
+		return;
+	}
+	
+	putChar(position, 0, c);
+	putChar(position, 1, c);
+}
+
+void MAX6952::flush() {
+	
+	queueDirty();
+	sendQueue();
+}
+
+void MAX6952::queueDirty(byte planes) {
+	
+	/*
+	 * A digit goes out through the combined register when both planes
+	 * are dirty and equal, otherwise one write per plane.
+	 */
+	for(int j = 0; j < maxDevices; j++){
+		
+		byte pending = dirty[j] & planes;
+		
+		if(pending == 0){
+			continue;
+		}
+		
+		for(int digit = 3; digit >= 0; digit--){
+			
+			byte mask0 = 1 << digit;
+			byte mask1 = 1 << (digit + 4);
+			int position = (j * 4) + digit;
+			byte c0 = status[position];
+			byte c1 = status[maxTextLength + position];
+			
+			if((pending & mask0) && (pending & mask1) && c0 == c1){
+				queueRegister(j, REG_P0P1_BASE + digit, c0);
+			} else {
+				if(pending & mask0){
+					queueRegister(j, REG_P0_BASE + digit, c0);
+				}
+				if(pending & mask1){
+					queueRegister(j, REG_P1_BASE + digit, c1);
+				}
+			}
+		}
+		
+		dirty[j] &= ~planes;
+	}
+}
+
+void MAX6952::setDoubleBuffer(bool on) {
+	
+	if(!on){
+		finishFlip();
+		flush();
+	}
+	
+	doubleBuffer = on;
+}
+
+void MAX6952::setFlipDelay(unsigned long milliseconds) {
+	flipDelay = milliseconds;
+}
+
+void MAX6952::present() {
+	
+	if(DEBUG){
+		Serial.println("Present");
+	}
+	
+	finishFlip();
+	
+	bool changed = false;
+	
+	for(int j = 0; j < maxDevices; j++){
+		if(dirty[j] != 0){
+			changed = true;
+		}
+	}
+	
+	if(!changed){
+		return;
+	}
+	
+	/*
+	 * While global blink is off the devices show plane 0, so the new
+	 * digits go into plane 1 without being seen. One broadcast frame
+	 * then starts the blink on all devices at the same time. When the
+	 * blink changes to plane 1, every digit of the chain changes in the
+	 * same moment. updatePresent() copies the digits into plane 0
+	 * during that phase and stops the blink again.
+	 *
+	 * The presented characters are kept apart, so drawing during the
+	 * flip waits for the next present().
+	 */
+	for(int j = 0; j < maxDevices; j++){
+		
+		for(int digit = 0; digit < 4; digit++){
+			
+			byte mask1 = 1 << (digit + 4);
+			int position = (j * 4) + digit;
+			byte c = status[position];
+			
+			/* Plane 1 of the device is known, unless its digit is dirty */
+			if((dirty[j] & mask1) || status[maxTextLength + position] != c){
+				queueRegister(j, REG_P1_BASE + digit, c);
+			}
+			
+			presented[position] = c;
+			
+			if(status[maxTextLength + position] == c){
+				dirty[j] &= ~mask1;
+			} else {
+				dirty[j] |= mask1;
+			}
+		}
+	}
+	
+	activateBlink(FAST_BLINK_RATE, true);
+	
+	flip.started = false;
+	flip.running = true;
+}
+
+bool MAX6952::updatePresent(unsigned long now) {
+	
+	if(!flip.running){
+		return false;
+	}
+	
+	if(!flip.started){
+		flip.start = now;
+		flip.started = true;
+	}
+	
+	/* Without the phase from the devices a small margin after the change, the oscillators are not exact */
+	int phase = getBlinkPhase();
+	
+	if(phase == 0 || (phase < 0 && (now - flip.start) < flipDelay + (flipDelay / 8))){
+		return true;
+	}
+	
+	finishFlip();
+	
+	return false;
+}
+
+bool MAX6952::isPresenting() {
+	return flip.running;
+}
+
+void MAX6952::finishFlip() {
+	
+	if(!flip.running){
+		return;
+	}
+	
+	flip.running = false;
+	
+	for(int j = 0; j < maxDevices; j++){
+		
+		for(int digit = 0; digit < 4; digit++){
+			
+			byte mask0 = 1 << digit;
+			byte mask1 = 1 << (digit + 4);
+			int position = (j * 4) + digit;
+			byte c0 = presented[position];
+			byte c1 = (blinkMask[j] & mask0) ? ' ' : c0;
+			
+			/* Plane 0 of the device is known, unless its digit is dirty */
+			if((dirty[j] & mask0) || status[position] != c0){
+				queueRegister(j, REG_P0_BASE + digit, c0);
+			}
+			
+			/* Plane 1 shows the presented character, a digit with a blink mask is blank */
+			if(c1 != c0){
+				queueRegister(j, REG_P1_BASE + digit, c1);
+			}
+			
+			/* What was drawn since present() stays dirty */
+			dirty[j] &= ~(mask0 | mask1);
+			
+			if(status[position] != c0){
+				dirty[j] |= mask0;
+			}
+			
+			if(status[maxTextLength + position] != c1){
+				dirty[j] |= mask1;
+			}
+		}
+	}
+	
+	activateText();
+}
+
+void MAX6952::setRefreshInterval(unsigned long milliseconds) {
+	
+	refreshInterval = milliseconds;
+	
+	/* A waiting update is not lost when the scheduler is switched off */
+	if(refreshInterval == 0 && schedule.pending){
+		schedule.pending = false;
+		applyRefresh(schedule.action, schedule.rate);
+	}
+}
+
+void MAX6952::requestRefresh(byte action, byte rate) {
+	
+	if(refreshInterval == 0){
+		applyRefresh(action, rate);
+		return;
+	}
+	
+	/*
+	 * The update waits for service(). A newer update replaces the one which
+	 * is waiting, the shadow already holds its digits. An update of the
+	 * digits alone keeps the configuration of the waiting one.
+	 */
+	if(schedule.pending){
+		coalescedCount++;
+	}
+	
+	if(!schedule.pending || action != REFRESH_DIGITS){
+		schedule.action = action;
+		schedule.rate = rate;
+	}
+	
+	schedule.pending = true;
+}
+
+void MAX6952::applyRefresh(byte action, byte rate) {
+	
+	flush();
+	
+	if(action == REFRESH_TEXT){
+		activateText();
+	} else if(action == REFRESH_BLINK){
+		activateBlink(rate, false);
+		textBlink = true;
+	}
+}
+
+bool MAX6952::service(unsigned long now) {
+	
+	if(!schedule.pending){
+		return false;
+	}
+	
+	if(schedule.started && (now - schedule.lastRefresh) < refreshInterval){
+		return true;
+	}
+	
+	schedule.pending = false;
+	schedule.started = true;
+	schedule.lastRefresh = now;
+	
+	applyRefresh(schedule.action, schedule.rate);
+	
+	return false;
+}
+
+unsigned long MAX6952::getCoalescedCount() {
+	return coalescedCount;
+}
+
+void MAX6952::writeDisplay(char * deviceBuffer) {
+	
+	if(!doubleBuffer){
+		finishFlip();
+	}
+	
+	for(int i = 0; i < maxTextLength; i++){
+		putChar(i, 0, deviceBuffer[i]);
+		putChar(i, 1, deviceBuffer[i]);
+	}
+	
+	if(!doubleBuffer){
+		requestRefresh(REFRESH_DIGITS, 0);
+	}
+}
+
+void MAX6952::layoutText(int plane, const char *text, int length, int position){
+	
+	layoutWindow(0, maxTextLength, plane, text, length, position);
+}
+
+int MAX6952::alignFront(int width, int length, int position){
+	
+	/* A text longer than the window starts at its first character */
+	if(length >= width){
+		return 0;
+	}
+	
+	switch(position){
+		case RIGHT:
+			return width - length;
+		
+		case CENTER:
+			return (width - length) / 2;
+		
+		default:
+			return 0;
+	}
+}
+
+void MAX6952::layoutWindow(int first, int width, int plane, const char *text, int length, int position){
+	
+	/*
+	 * The text is placed directly into the shadow, the free characters are
+	 * filled with blanks. A text longer than the window is cut.
+	 */
+	int front = alignFront(width, length, position);
+	
+	if(DEBUG_LVL_2){
+		Serial.print("Window:");
+		Serial.print(width);
+		Serial.print(" InputTextLength:");
+		Serial.print(length);
+		Serial.print(" Front:");
+		Serial.println(front);
+	}
+	
+	for(int i = 0; i < width; i++){
+		
+		int index = i - front;
+		
+		putChar(first + i, plane, (index >= 0 && index < length) ? text[index] : ' ');
+	}
+}
+
+void MAX6952::setText(const String &inputText, int position){
+	
+	setText(inputText.c_str(), inputText.length(), position);
+}
+
+void MAX6952::setText(const char *inputText, int position){
+	
+	setText(inputText, strlen(inputText), position);
+}
+
+void MAX6952::setText(const char *inputText, int length, int position){
+	
+	if(DEBUG){
+		Serial.println("Set Text");
+	}
+	
+	/*
+	 * The new text is written over the old one, only digits which change
+	 * are sent. The configuration is only written when blink or shutdown
+	 * have to change. A running flip is finished first, unless the text
+	 * waits for present().
+	 */
+	if(!doubleBuffer){
+		finishFlip();
+	}
+	
+	layoutText(0, inputText, length, position);
+	layoutText(1, inputText, length, position);
+	
+	/* In double buffer mode the text waits for present() */
+	if(doubleBuffer){
+		return;
+	}
+	
+	requestRefresh(REFRESH_TEXT, 0);
+}
+
+int MAX6952::formatNumber(char *buffer, long value, int width, int decimals){
+	
+	unsigned long magnitude = (value < 0) ? 0UL - (unsigned long)value : (unsigned long)value;
+	
+	return formatNumber(buffer, magnitude, value < 0, width, decimals);
+}
+
+int MAX6952::formatNumber(char *buffer, unsigned long value, int width, int decimals){
+	
+	return formatNumber(buffer, value, false, width, decimals);
+}
+
+int MAX6952::formatNumber(char *buffer, unsigned long magnitude, bool negative, int width, int decimals){
+	
+	/* The characters are built from the last one, then turned around */
+	char reverse[MAX_NUMBER_LENGTH];
+	unsigned long rest = magnitude;
+	int length = 0;
+	
+	if(width > MAX_NUMBER_LENGTH){
+		width = MAX_NUMBER_LENGTH;
+	}
+	
+	if(decimals < 0){
+		decimals = 0;
+	}
+	
+	/* All digits of an unsigned long, the point and the sign always fit */
+	if(decimals > MAX_NUMBER_LENGTH - 3){
+		decimals = MAX_NUMBER_LENGTH - 3;
+	}
+	
+	for(int i = 0; rest > 0 || i <= decimals; i++){
+		
+		if(i == decimals && decimals > 0){
+			reverse[length++] = '.';
+		}
+		
+		reverse[length++] = '0' + (rest % 10);
+		rest /= 10;
+	}
+	
+	if(negative){
+		reverse[length++] = '-';
+	}
+	
+	while(length < width){
+		reverse[length++] = ' ';
+	}
+	
+	for(int i = 0; i < length; i++){
+		buffer[i] = reverse[length - 1 - i];
+	}
+	
+	return length;
+}
+
+int MAX6952::formatNumber(char *buffer, double value, int width, int decimals){
+	
+	if(decimals < 0){
+		decimals = 0;
+	}
+	
+	if(decimals > 6){
+		decimals = 6;
+	}
+	
+	double scaled = value;
+	
+	for(int i = 0; i < decimals; i++){
+		scaled *= 10.0;
+	}
+	
+	scaled += (scaled < 0) ? -0.5 : 0.5;
+	
+	/* Too large for a long, or not a number */
+	if(!(scaled > -2147483647.0 && scaled < 2147483647.0)){
 		
-   
-	} else {
+		int length = (width > 0) ? width : 1;
 		
-		if(DEBUG){
-			Serial.println("Input > Display");
+		if(length > MAX_NUMBER_LENGTH){
+			length = MAX_NUMBER_LENGTH;
 		}
 		
-		inputText.getBytes((byte*)deviceBuffer,sizeof(deviceBuffer)+1);
-	   
-		if(DEBUG){
-			Serial.print("MaxTextLength:");
-			Serial.print(maxTextLength);
-			Serial.print(" InputTextLength:");
-			Serial.println(inputText.length());
-			Serial.print("Input Text >");
-			Serial.print(inputText);
-			Serial.print("< Output Text >");
-			Serial.print(deviceBuffer);
-			Serial.println("<");
-		}
-
+		memset(buffer, '-', length);
 		
+		return length;
 	}
- 
-  
- 
-  
+	
+	return formatNumber(buffer, (long)scaled, width, decimals);
+}
+
+int MAX6952::fitNumber(char *buffer, int length, int window){
+	
+	int blanks = 0;
+	
+	/* Only the padding in front of the number can go */
+	while(length - blanks > window && buffer[blanks] == ' '){
+		blanks++;
+	}
+	
+	if(blanks > 0){
+		memmove(buffer, buffer + blanks, length - blanks);
+		length -= blanks;
+	}
+	
+	/* Cut digits would show a wrong number */
+	if(length > window){
+		length = (window > 0) ? window : 0;
+		memset(buffer, '-', length);
+	}
+	
+	return length;
+}
+
+void MAX6952::setNumber(int value, int width, int decimals, int position){
+	
+	setNumber((long)value, width, decimals, position);
+}
+
+void MAX6952::setNumber(long value, int width, int decimals, int position){
+	
+	char text[MAX_NUMBER_LENGTH];
+	
+	int length = formatNumber(text, value, width, decimals);
+	
+	setText(text, fitNumber(text, length, maxTextLength), position);
+}
+
+void MAX6952::setNumber(unsigned int value, int width, int decimals, int position){
+	
+	setNumber((unsigned long)value, width, decimals, position);
+}
+
+void MAX6952::setNumber(unsigned long value, int width, int decimals, int position){
+	
+	char text[MAX_NUMBER_LENGTH];
+	
+	int length = formatNumber(text, value, width, decimals);
+	
+	setText(text, fitNumber(text, length, maxTextLength), position);
+}
+
+void MAX6952::setNumber(double value, int width, int decimals, int position){
+	
+	char text[MAX_NUMBER_LENGTH];
+	
+	int length = formatNumber(text, value, width, decimals);
+	
+	setText(text, fitNumber(text, length, maxTextLength), position);
+}
+
+void MAX6952::setTextBlink(const String &inputText,int speed, int position){
+	
+	setTextBlink(inputText.c_str(), speed, position);
+}
+
+void MAX6952::setTextBlink(const char *inputText,int speed, int position){
+	
+	setTextBlink(inputText, "", speed, position);
+}
+
+void MAX6952::setTextBlink(const String &text1, const String &text2, int speed, int position){
+	
+	setTextBlink(text1.c_str(), text2.c_str(), speed, position);
+}
+
+void MAX6952::setTextBlink(const char *text1, const char *text2, int speed, int position){
+	
+	if(DEBUG){
+		Serial.println("Set Text Blink");
+	}
+	
+	finishFlip();
+	memset(blinkMask, 0, maxDevices);
+	
+	/* Plane 0 is shown in the first half of the blink period, plane 1 in the second */
+	layoutText(0, text1, strlen(text1), position);
+	layoutText(1, text2, strlen(text2), position);
+	
+	/* Both planes are ready before the blink starts, synchronized on all devices */
+	requestRefresh(REFRESH_BLINK, (speed == BLINK_SLOW) ? SLOW_BLINK_RATE : FAST_BLINK_RATE);
+}
+
+
+void MAX6952::setTextMarquee(const String &inputText,int speed, int mode, int direction){
+	
+	/* The text does not change while the marquee is running */
+	setTextMarquee(inputText.c_str(), speed, mode, direction);
+}
 
-	if(maxDevices == 1){
+void MAX6952::setTextMarquee(const char *inputText,int speed, int mode, int direction){
+	
+	if(DEBUG){
+		Serial.println("Set Text Marquee");
+	}
+	
+	startMarquee(inputText, speed, mode, direction);
+	
+	/* The time until the next step is waited with delay(), it counts as blocking */
+	while(updateMarquee(millis())){
 		
-		if(DEBUG){
-			Serial.println("Nur ein Max6952");
-		}
-		
-		for(int i = 1;i < 5;i++){
-			
-		   
-		    digitalWrite(SPI_CS, LOW);
-		   
-			if(DEBUG){
-				Serial.println("LOW");
-				Serial.print("Device:");
-				Serial.print(1);
-				Serial.print(" Digit:");
-				Serial.print(4-i);
-				Serial.print(" Addr: ");
-				Serial.print(REG_P0_BASE + (4-i) );
-				Serial.print(" ->");
-				Serial.print(deviceBuffer[(1*4)-i]);
-				Serial.println("");
-			}
+		unsigned long elapsed = millis() - marquee.lastUpdate;
+		
+		if(elapsed < (unsigned long)marquee.speed){
 			
-		    
-			SPI.transfer(REG_P0_BASE + (4-i) );
-			SPI.transfer(deviceBuffer[(1*4)-i]);
-
-		  
-		    if(DEBUG){
-				Serial.println("HIGH");
-			}
+			unsigned long wait = marquee.speed - elapsed;
 			
-		    digitalWrite(SPI_CS, HIGH);
-		    delay(1);
-        }
-	} else {
+			blockingMicros += wait * 1000UL;
+			delay(wait);
+		}
+	}
+}
+
+void MAX6952::startMarquee(const String &inputText,int speed, int mode, int direction){
+	
+	/* The copy keeps its memory, a text of the same length is not allocated again */
+	marquee.copy = inputText;
+	
+	startMarquee(marquee.copy.c_str(), speed, mode, direction);
+}
+
+void MAX6952::startMarquee(const char *inputText,int speed, int mode, int direction){
+	
+	if(DEBUG){
+		Serial.println("Start Marquee");
+	}
+	
+	finishFlip();
+	memset(blinkMask, 0, maxDevices);
+	activateSteady();
+	
+	int length = strlen(inputText);
+	
+	if(mode == BOUNCE && length > maxTextLength){
 		
 		if(DEBUG){
-			Serial.println("Mehrere Max6952");
+			Serial.println("BOUNCE mode not possible. Input text too long. Switch to classic marquee");
 		}
 		
-		for(int i = 1;i < 5;i++){
-			
-			digitalWrite(SPI_CS, LOW);
-			
-			if(DEBUG){
-				Serial.println("LOW");
-			}
-    
-			for(int j = maxDevices; j > 0 ;j--){
-
-			if(DEBUG){
-				Serial.print("Device:");
-				Serial.print(j);
-				Serial.print(" Digit:");
-				Serial.print(4-i);
-				Serial.print(" Addr: ");
-				Serial.print(REG_P0_BASE + (4-i) );
-				Serial.print(" ->");
-				Serial.print(deviceBuffer[(j*4)-i]);
-				Serial.println("");
-			}
-			
-			SPI.transfer(REG_P0_BASE + (4-i) );
-			SPI.transfer(deviceBuffer[(j*4)-i]);
-    
-			}
-			if(DEBUG){
-				Serial.println("HIGH");
-			}
-			
-			digitalWrite(SPI_CS, HIGH);
-			delay(1);
+		mode = CLASSIC;
+	}
+	
+	if(mode != BOUNCE){
+		
+		if(DEBUG){
+			Serial.println("CLASSIC");
 		}
+		
+		mode = CLASSIC;
+	}
+	
+	marquee.text = inputText;
+	marquee.length = length;
+	marquee.speed = speed;
+	marquee.mode = mode;
+	marquee.direction = direction;
+	marquee.step = 0;
+	marquee.lastUpdate = 0;
+	
+	/*
+	 * The text is scrolled through a window of maxTextLength characters.
+	 * CLASSIC moves it in from one side and out at the other side,
+	 * BOUNCE moves it between the left and the right border and back.
+	 */
+	if(mode == BOUNCE){
+		marquee.padding = maxTextLength - length;
+		marquee.steps = 2 * marquee.padding;
+	} else {
+		marquee.padding = maxTextLength;
+		marquee.steps = maxTextLength + length;
+	}
+	
+	/* The smooth marquee moves by columns instead of characters */
+	marquee.smooth = (smoothBudget > 0);
+	
+	if(marquee.smooth){
+		marquee.padding *= SMOOTH_PITCH;
+		marquee.steps *= SMOOTH_PITCH;
 	}
-  
- 
 	
+	marquee.running = (marquee.steps > 0);
+	
+	/* The same marquee again replays the frames of the last run */
+	unsigned long key = marqueeKey();
+	
+	if(marquee.smooth){
+		
+		/* The frames of the smooth marquee depend on the font RAM, they are not recorded */
+		marqueeCache.replaying = false;
+		marqueeCache.recording = false;
+		
+	} else if(marqueeCache.buffer != NULL && key == marqueeCache.key && marqueeCache.steps > 0){
+		marqueeCache.replaying = true;
+		marqueeCache.recording = false;
+	} else {
+		marqueeCache.key = key;
+		marqueeCache.used = 0;
+		marqueeCache.steps = 0;
+		marqueeCache.replaying = false;
+		marqueeCache.recording = (marqueeCache.buffer != NULL);
+	}
 	
+	marqueeCache.read = 0;
+	marqueeCache.step = 0;
 }
 
-
-void MAX6952::setTextMarquee(String inputText,int speed, int mode, int direction){
+unsigned long MAX6952::marqueeKey(){
 	
-	if(DEBUG){
-		Serial.println("Set Text Marquee");
+	/* FNV-1a over the text and everything else which changes the frames */
+	unsigned long key = 2166136261UL;
+	
+	for(int i = 0; i < marquee.length; i++){
+		key = (key ^ (byte)marquee.text[i]) * 16777619UL;
 	}
 	
-	clearDisplay();
-	setRegister(REG_CONFIGURATION, ACTIVE_MODE );
+	key = (key ^ marquee.length) * 16777619UL;
+	key = (key ^ marquee.mode) * 16777619UL;
+	key = (key ^ marquee.direction) * 16777619UL;
+	key = (key ^ maxDevices) * 16777619UL;
+	
+	return key;
+}
+
+void MAX6952::setMarqueeCache(byte *buffer, int size){
 	
-	String outputText ="";
+	marqueeCache.buffer = buffer;
+	marqueeCache.size = (buffer != NULL) ? size : 0;
+	marqueeCache.used = 0;
+	marqueeCache.steps = 0;
+	marqueeCache.recording = false;
+	marqueeCache.replaying = false;
+	marqueeCache.capture = false;
+}
 
+void MAX6952::sendMarqueeStep(){
 	
-	char deviceBuffer[maxTextLength];
-	char marqueeBuffer[(2 * maxTextLength) + inputText.length()];
- 
-	memset(deviceBuffer,0x00,sizeof(deviceBuffer));
-	memset(marqueeBuffer,0x00,sizeof(marqueeBuffer));
+	/* Step 0 depends on what was shown before the marquee, it is always built */
+	if(marquee.step == 0){
+		flush();
+		return;
+	}
 	
-	if(inputText.length() > maxTextLength){
+	if(marqueeCache.replaying && marqueeCache.step >= marqueeCache.steps){
 		
-		if(mode == BOUNCE){
-			
-			if(DEBUG){
-				Serial.println("BOUNCE mode not possible. Input text too long. Switch to classic marquee");
-				mode = CLASSIC;
-				
-			}
-			
-			
+		/* The rest of the last run was not recorded, record it now */
+		marqueeCache.replaying = false;
+		marqueeCache.recording = true;
+	}
+	
+	if(marqueeCache.replaying){
+		
+		sendQueue();
+		
+		int length = maxDevices * 2;
+		byte count = marqueeCache.buffer[marqueeCache.read++];
+		
+		for(int f = 0; f < count; f++){
+			memcpy(frame, &marqueeCache.buffer[marqueeCache.read], length);
+			marqueeCache.read += length;
+			writeFrame();
 		}
+		
+		/* The frames bring the devices in sync with the shadow */
+		memset(dirty, 0, maxDevices);
+		marqueeCache.step++;
+		
+		return;
 	}
- 
 	
-	switch(mode){
-		case CLASSIC:
-		{
-			if(DEBUG){
-				Serial.println("CLASSIC");
-			}
-			for(int i = 0; i < (maxTextLength);i++){
-				outputText.concat(" ");
-			}
-			outputText.concat(inputText);
-			
-			for(int i = 0; i < (maxTextLength);i++){
-				outputText.concat(" ");
-			}
+	if(!marqueeCache.recording || marqueeCache.used >= marqueeCache.size){
+		marqueeCache.recording = false;
+		flush();
+		return;
+	}
+	
+	/* Writes queued by other calls are not part of the step */
+	sendQueue();
+	
+	/* writeFrame() appends the frames of this step behind the count */
+	int start = marqueeCache.used++;
+	
+	marqueeCache.overflow = false;
+	marqueeCache.capture = true;
+	
+	flush();
+	
+	marqueeCache.capture = false;
+	
+	if(marqueeCache.overflow){
+		marqueeCache.used = start;
+		marqueeCache.recording = false;
+		return;
+	}
+	
+	marqueeCache.buffer[start] = (marqueeCache.used - start - 1) / (maxDevices * 2);
+	marqueeCache.steps++;
+	marqueeCache.step++;
+	marqueeCache.read = marqueeCache.used;
+}
+
+bool MAX6952::updateMarquee(unsigned long now){
+	
+	if(!marquee.running){
+		return false;
+	}
+	
+	if(marquee.step > 0 && (now - marquee.lastUpdate) < (unsigned long)marquee.speed){
+		return true;
+	}
+	
+	if(marquee.step >= marquee.steps){
+		marquee.running = false;
+		return false;
+	}
+	
+	int step = marquee.step;
+	int offset = marqueeOffset(step, marquee.steps, marquee.padding, marquee.mode, marquee.direction);
+	
+	if(DEBUG_LVL_2){
+		Serial.print("Marquee Step:");
+		Serial.print(step);
+		Serial.print(" Offset:");
+		Serial.println(offset);
+	}
+	
+	/* The recorded frames only fit when nothing else changed the shadow since the last step */
+	if(step > 0 && shadowChanges != marquee.changes){
+		marqueeCache.replaying = false;
+		marqueeCache.recording = false;
+	}
+	
+	/* Text position of the first character (or column) in the window */
+	int first = offset - marquee.padding;
+	
+	if(marquee.smooth){
+		
+		layoutSmooth(first);
+		flush();
+		
+	} else {
+		
+		for(int i = 0; i < maxTextLength; i++){
 			
-			outputText.toCharArray(marqueeBuffer,sizeof(marqueeBuffer)+1);
-			
-			if(DEBUG){
-				Serial.print("MaxTextLength:");
-				Serial.print(maxTextLength);
-				Serial.print(" InputTextLength:");
-				Serial.println(inputText.length());
-				Serial.print("Input Text >");
-				Serial.print(inputText);
-				Serial.print("< Output Text >");
-				Serial.print(marqueeBuffer);
-				Serial.println("<");
-			}
+			int index = first + i;
+			byte c = (index >= 0 && index < marquee.length) ? marquee.text[index] : ' ';
 			
-			if(direction){
-				
-				if(DEBUG){
-					Serial.println("RIGHT_TO_LEFT");
-				}
-				
-				for(int i=0;i<(sizeof(marqueeBuffer)-maxTextLength);i++){
+			putChar(i, 0, c);
+			putChar(i, 1, c);
+		}
 		
-				strncpy(deviceBuffer,&marqueeBuffer[i],sizeof(deviceBuffer));
-				writeDisplay(deviceBuffer);
-				delay(speed);
-				}
-			} else{
-				
-				if(DEBUG){
-					Serial.println("LEFT_TO_RIGTH");
-				}
-				
-				for(int i=(sizeof(marqueeBuffer)-maxTextLength);i>0;i--){
+		sendMarqueeStep();
+	}
+	
+	marquee.changes = shadowChanges;
+	marquee.step++;
+	marquee.lastUpdate = now;
+	
+	return true;
+}
+
+int MAX6952::marqueeOffset(int step, int steps, int padding, int mode, int direction){
+	
+	if(mode == BOUNCE){
 		
-				strncpy(deviceBuffer,&marqueeBuffer[i],sizeof(deviceBuffer));
-				writeDisplay(deviceBuffer);
-				delay(speed);
-				}	
-			}
-			
-			break;
+		if(direction){
+			return (step < padding) ? step : (2 * padding) - step;
 		}
 		
+		return (step < padding) ? padding - step : step - padding;
+	}
+	
+	if(direction){
+		return step;
+	}
+	
+	return steps - step;
+}
+
+byte MAX6952::marqueeChar(int index){
+	
+	return (index >= 0 && index < marquee.length) ? marquee.text[index] : ' ';
+}
+
+void MAX6952::setSmoothScroll(bool on, int uploadBudget){
+	
+	if(uploadBudget < 1){
+		uploadBudget = 1;
+	}
+	
+	if(uploadBudget > 4){
+		uploadBudget = 4;
+	}
+	
+	smoothBudget = on ? uploadBudget : 0;
+}
+
+void MAX6952::layoutSmooth(int first){
+	
+	/*
+	 * The text is a row of SMOOTH_PITCH columns per character. Each digit
+	 * shows 5 columns of it. At a character border the digit shows the
+	 * character itself, between the borders a glyph made of the right part
+	 * of one character and the left part of the next one. A glyph which is
+	 * already in the font RAM of the device is used again. A new glyph goes
+	 * into the first free slot from the bank of this step on, the banks
+	 * are used in turns so the font RAM keeps the older glyphs. The slots
+	 * shown before the step and the ones used in it are locked, so no
+	 * glyph is overwritten while it is shown. When a device has used its
+	 * upload budget, the digit shows the character which covers most of it.
+	 */
+	int bank = (marquee.step % SMOOTH_BANKS) * 4;
+	
+	for(int j = 0; j < maxDevices; j++){
 		
-		case BOUNCE:
-		{
-			if(DEBUG){
-				Serial.println("BOUNCE");
-			}
+		int uploads = 0;
+		unsigned long locked = 0;
 		
-										
-			for(int i = 0; i < (maxTextLength - inputText.length());i++){
-				outputText.concat(" ");
-			}
-			outputText.concat(inputText);
+		for(int digit = 0; digit < 4; digit++){
 			
+			byte shown = status[(j * 4) + digit];
 			
-			for(int i = 0; i < (maxTextLength - inputText.length());i++){
-				outputText.concat(" ");
+			if(shown < 0x10){
+				locked |= 1UL << shown;
+			} else if(shown >= 0x80 && shown < 0x80 + USER_FONT_SLOTS - 16){
+				locked |= 1UL << (shown - 0x80 + 16);
 			}
+		}
+		
+		for(int digit = 0; digit < 4; digit++){
 			
-			outputText.toCharArray(marqueeBuffer,sizeof(marqueeBuffer)+1);
+			int position = (j * 4) + digit;
+			int column = first + (position * SMOOTH_PITCH);
 			
+			/* Rounded down for negative columns too */
+			int index = (column >= 0) ? column / SMOOTH_PITCH : -((SMOOTH_PITCH - 1 - column) / SMOOTH_PITCH);
+			int shift = column - (index * SMOOTH_PITCH);
+			byte c = marqueeChar(index);
 			
-			if(DEBUG){
-				Serial.print("MaxTextLength:");
-				Serial.print(maxTextLength);
-				Serial.print(" InputTextLength:");
-				Serial.println(inputText.length());
-				Serial.print("Input Text >");
-				Serial.print(inputText);
-				Serial.print("< Output Text >");
-				Serial.print(marqueeBuffer);
-				Serial.println("<");
+			if(shift == 0){
+				putChar(position, 0, c);
+				putChar(position, 1, c);
+				continue;
 			}
 			
+			byte glyph[USER_FONT_COLUMNS];
+			bool blank = true;
 			
-			if(direction){
+			for(int i = 0; i < USER_FONT_COLUMNS; i++){
 				
-				if(DEBUG){
-					Serial.println("RIGHT_TO_LEFT");
-				}
+				int x = shift + i;
+				byte ch = (x < SMOOTH_PITCH) ? c : marqueeChar(index + 1);
 				
-				for(int i=0;i<(maxTextLength - inputText.length());i++){
-		
-					strncpy(deviceBuffer,&marqueeBuffer[i],sizeof(deviceBuffer));
-					writeDisplay(deviceBuffer);
-					delay(speed);
-				}
-				for(int i=(maxTextLength - inputText.length());i > 0; i--){
-					
-					strncpy(deviceBuffer,&marqueeBuffer[i],sizeof(deviceBuffer));
-					writeDisplay(deviceBuffer);
-					delay(speed);
-					
+				if(x >= SMOOTH_PITCH){
+					x -= SMOOTH_PITCH;
 				}
 				
-			} else{
+				glyph[i] = 0x00;
 				
-				if(DEBUG){
-					Serial.println("LEFT_TO_RIGTH");
+				if(x < USER_FONT_COLUMNS && ch >= FONT_FIRST_CHAR && ch <= FONT_LAST_CHAR){
+					glyph[i] = pgm_read_byte(&MAX6952_FONT[((ch - FONT_FIRST_CHAR) * USER_FONT_COLUMNS) + x]);
 				}
 				
-				for(int i=(maxTextLength - inputText.length());i > 0; i--){
-					
-					strncpy(deviceBuffer,&marqueeBuffer[i],sizeof(deviceBuffer));
-					writeDisplay(deviceBuffer);
-					delay(speed);
-					
-				}
-				for(int i=0;i<(maxTextLength - inputText.length());i++){
-		
-					strncpy(deviceBuffer,&marqueeBuffer[i],sizeof(deviceBuffer));
-					writeDisplay(deviceBuffer);
-					delay(speed);
+				if(glyph[i] != 0x00){
+					blank = false;
 				}
-				
-				
 			}
 			
+			if(blank){
+				putChar(position, 0, ' ');
+				putChar(position, 1, ' ');
+				continue;
+			}
 			
+			int slot = findGlyph(j, glyph);
 			
-			
-			
-			
-			
-			
-			
-			break;
-		}
-		
-		default:
-		{
+			if(slot < 0 && uploads < smoothBudget){
 				
-			if(DEBUG){
-				Serial.println("Default: CLASSIC");
-			}
-			for(int i = 0; i < (maxTextLength);i++){
-				outputText.concat(" ");
+				/* At most 8 slots are locked, one of the 24 is always free */
+				for(int i = 0; i < USER_FONT_SLOTS; i++){
+					
+					int free = (bank + i) % USER_FONT_SLOTS;
+					
+					if(!(locked & (1UL << free))){
+						slot = free;
+						break;
+					}
+				}
+				
+				queueGlyph(j, slot, glyph);
+				uploads++;
 			}
-			outputText.concat(inputText);
 			
-			for(int i = 0; i < (maxTextLength);i++){
-				outputText.concat(" ");
+			if(slot >= 0){
+				locked |= 1UL << slot;
 			}
 			
-			outputText.toCharArray(marqueeBuffer,sizeof(marqueeBuffer)+1);
-			
-			if(DEBUG){
-				Serial.print("MaxTextLength:");
-				Serial.print(maxTextLength);
-				Serial.print(" InputTextLength:");
-				Serial.println(inputText.length());
-				Serial.print("Input Text >");
-				Serial.print(inputText);
-				Serial.print("< Output Text >");
-				Serial.print(marqueeBuffer);
-				Serial.println("<");
+			if(slot < 0){
+				c = (shift < SMOOTH_PITCH / 2) ? c : marqueeChar(index + 1);
+			} else {
+				c = USER_FONT_CHAR(slot);
 			}
 			
-			if(RIGHT_TO_LEFT){
-				
-				for(int i=0;i<(sizeof(marqueeBuffer)-maxTextLength);i++){
-		
-				strncpy(deviceBuffer,&marqueeBuffer[i],sizeof(deviceBuffer));
-				writeDisplay(deviceBuffer);
-				delay(speed);
-				}
-			} else{
-				for(int i=0;i<(sizeof(marqueeBuffer)-maxTextLength);i++){
-		
-				strncpy(deviceBuffer,&marqueeBuffer[i],sizeof(deviceBuffer));
-				writeDisplay(deviceBuffer);
-				delay(speed);
-				}	
-			}
-		
-			break;
-		}	
+			putChar(position, 0, c);
+			putChar(position, 1, c);
+		}
 	}
-	 
+}
+
+bool MAX6952::isMarqueeRunning(){
+	return marquee.running;
+}
+
+void MAX6952::stopMarquee(){
+	marquee.running = false;
 }
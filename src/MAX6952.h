@@ -1,5 +1,5 @@
 /*
- *    MAX6952.h - A library for controling multiple (max 16) MAX6952
+ *    MAX6952.h - A library for controling multiple MAX6952
  *    Copyright (c) 2019 Kai Krause
  * 
  *    Permission is hereby granted, free of charge, to any person
@@ -31,8 +31,8 @@
   * If the text is shorter than the MaxTextLength, it is padded with blanks.
   * If the text is longer, only the first MaxTextLength- characters are used in static mode.
   *
-  * Intensity can only set for all MAX6952  
-  * Shutdown only for all MAX6952
+  * Intensity and shutdown can be set for all MAX6952 or for a single device.
+  * Devices are counted from 0, the first device in the chain shows the first 4 characters.
   *
   *
   */
@@ -50,6 +50,8 @@
 #include <WProgram.h>
 #endif
 
+#include "MAX6952Transport.h"
+
 #define LEFT				0
 #define CENTER				2
 #define RIGHT				1
@@ -60,6 +62,44 @@
 #define CLASSIC				0
 #define BOUNCE				1
 
+#define BLINK_FAST			0
+#define BLINK_SLOW			1
+
+/* Upper limit for the number of devices in a chain, can be set as a build flag */
+#ifndef MAX_DEVICES
+#define	MAX_DEVICES			128
+#endif
+#define MAX_QUEUE_DEPTH		8
+
+/* Bytes of buffer needed per device, see DEVICE_BUFFER_SIZE() */
+#define DEVICE_BUFFER_BYTES	(8 + 1 + 2 + (MAX_QUEUE_DEPTH * 2) + 1 + 1 + 2 + 1 + 1 + 4)
+
+/* Bytes needed for the buffer of a chain of devices */
+#define DEVICE_BUFFER_SIZE(devices)	((devices) * DEVICE_BUFFER_BYTES)
+
+#define ALL_DEVICES			-1
+#define ALL_DIGITS			-1
+
+#define USER_FONT_SLOTS		24
+#define USER_FONT_COLUMNS	5
+
+/* Bytes needed by setFontCache() for a chain of devices */
+#define FONT_CACHE_SIZE(devices)	((devices) * USER_FONT_SLOTS * USER_FONT_COLUMNS)
+
+/* What a refresh sends after the digits, see setRefreshInterval() */
+#define REFRESH_DIGITS		0	//only the digits
+#define REFRESH_TEXT		1	//steady text, blink for the digits with a blink mask
+#define REFRESH_BLINK		2	//global blink
+
+/* Longest text formatNumber() builds, longer widths are cut */
+#define MAX_NUMBER_LENGTH	24
+
+/* Bytes needed by setMarqueeCache() for all steps of a CLASSIC marquee */
+#define MARQUEE_CACHE_SIZE(devices, length)	(((devices) * 4 + (length)) * (1 + ((devices) * 8)))
+
+/* Character code of a user defined font slot: 0x00..0x0F and 0x80..0x87 */
+#define USER_FONT_CHAR(slot)		((slot) < 16 ? (slot) : 0x80 + (slot) - 16)
+
 
 
 class MAX6952 {
@@ -69,29 +109,223 @@ class MAX6952 {
         /* Send out a single command to the device */
         //void spiTransfer(int addr, byte opcode, byte data);
 
-        /* We keep track of the led-status for all 8 devices in this array */
-        byte status[64];
-        /* Data is shifted out of this pin*/
-        int SPI_MOSI;
-        /* The clock is signaled on this pin */
-        int SPI_CLK;
-        /* This one is driven LOW for chip selectzion */
-        int SPI_CS;
+        /* All buffers below are parts of one buffer of DEVICE_BUFFER_SIZE(maxDevices) bytes */
+
+        /* Shadow of the digit registers of all devices, 8 bytes per device.
+         * Plane 0 is stored at [position], plane 1 at [maxTextLength + position],
+         * where position = device * 4 + digit is the character index in the text. */
+        byte *status;
+        /* Digit registers that are not in sync with the device.
+         * One byte per device, bit (plane * 4 + digit) */
+        byte *dirty;
+        /* One chip-select frame, the data for the last device in the chain first */
+        byte *frame;
+        /* Register writes waiting for sendQueue(), MAX_QUEUE_DEPTH addr/data pairs per device */
+        byte *queue;
+        /* Number of queued writes per device */
+        byte *queueCount;
+        /* Number of frames in the queue, the highest queueCount */
+        int queueFrames;
+        /* Number of queued frames already sent by sendQueueFrame() */
+        int queueSent;
+        /* Last configuration written to each device (S, B and E bits) */
+        byte *config;
+        /* Last values of REG_INTENSITY_10 and REG_INTENSITY_32 per device */
+        byte *intensity;
+        /* Font address pointer of each device, 0xFF if not known */
+        byte *fontAddress;
+        /* Digits which blink in steady text, bit digit */
+        byte *blinkMask;
+        /* The characters present() sent to plane 1, copied into plane 0 by the flip */
+        byte *presented;
+
+        /* Copy of the user defined fonts of all devices, NULL if not used */
+        byte *fontCache;
+
+		/* State of the intensity fade driven by updateFade() */
+		struct {
+			int device;
+			int from;
+			int to;
+			unsigned long duration;
+			unsigned long start;
+			bool started;
+			bool running;
+		} fade;
+		/* State of the page flip driven by updatePresent() */
+		struct {
+			unsigned long start;
+			bool started;
+			bool running;
+		} flip;
+		/* MISO is connected to DOUT of the last device */
+		bool phaseReadBack;
+		/* Text is only drawn into the shadow until present() */
+		bool doubleBuffer;
+		/* The global blink belongs to setTextBlink(), not to a blink mask */
+		bool textBlink;
+		/* Milliseconds from the blink sync to the plane 1 phase */
+		unsigned long flipDelay;
+        /* The frames are sent with this transport, NULL for hardwareSPI */
+        MAX6952Transport *transport;
+        /* Transport used by the constructor with pins, kept inside the object so copies work */
+        MAX6952HardwareSPI hardwareSPI;
         /* The maximum number of devices we use */
         int maxDevices;
 		/* The maximum characters we can display */
 		int maxTextLength;
+		/* Microseconds CS is held high after each frame */
+		unsigned int frameGuard;
+		/* Called with every frame before it is sent, NULL if not used */
+		void (*frameCallback)(const byte *frame, int length);
+		/* Milliseconds between two refreshes of service(), 0 = every update is sent */
+		unsigned long refreshInterval;
+		/* The update waiting for service() */
+		struct {
+			byte action;
+			byte rate;
+			unsigned long lastRefresh;
+			bool started;
+			bool pending;
+		} schedule;
+		/* Updates which were replaced by a newer one before they were sent */
+		unsigned long coalescedCount;
+		/* Number of frames and bytes sent since resetBusStatistics() */
+		unsigned long frameCount;
+		unsigned long byteCount;
+		/* Microseconds spent in delays since resetBusStatistics() */
+		unsigned long blockingMicros;
+
+		/* Set up the buffer and the devices, called by the constructors */
+		void init(int numDevices, byte *buffer);
+		/* The transport the frames are sent with */
+		MAX6952Transport *bus();
+		/* Store a character in the shadow, plane 0 or 1 */
+		void putChar(int position, int plane, byte c);
+		/* Place a text into one plane of the shadow, padded with blanks */
+		void layoutText(int plane, const char *text, int length, int position);
+		/* Place a text into width characters of one plane from first on */
+		void layoutWindow(int first, int width, int plane, const char *text, int length, int position);
+		/* Blanks in front of a text of length characters aligned in width, shared with MAX6952Group */
+		static int alignFront(int width, int length, int position);
+		/* Shift out the frame buffer to all devices. With receive the frame is
+		 * replaced with the bytes from MISO, returns false if the bus can not receive. */
+		bool writeFrame(bool receive = false);
+		/* Queue a configuration write and remember its state bits */
+		void queueConfig(int device, byte value);
+		/* Write the configuration to the devices where (config & ~mask) | bits differs */
+		void updateConfig(byte mask, byte bits);
+		/* Switch the global blink off, as needed for steady text. The S bit of each device is kept */
+		void activateSteady();
+		/* Switch the global blink on at the rate, synchronized in one frame when the
+		 * blink starts on any device or when sync is set. The S bit of each device is kept */
+		void activateBlink(byte rate, bool sync);
+		/* Steady text, with the global blink on when a digit has a blink mask */
+		void activateText();
+		/* Send the changed digits and the configuration for the action (REFRESH_...),
+		 * or leave them for service() */
+		void requestRefresh(byte action, byte rate);
+		/* Send the changed digits and the configuration for the action */
+		void applyRefresh(byte action, byte rate);
+		/* Queue the intensity registers of the digit (or ALL_DIGITS) if they change */
+		void queueIntensity(int device, int digit, int level);
+		/* Queue the digit registers of the planes (bits of dirty[]) which are not in sync */
+		void queueDirty(byte planes = 0xFF);
+		/* Copy the presented digits into plane 0 and stop the blink. Digits drawn
+		 * since present() stay dirty for the next present() */
+		void finishFlip();
+
+		/* State of the marquee driven by updateMarquee() */
+		struct {
+			const char *text;
+			int length;
+			String copy;
+			int speed;
+			int mode;
+			int direction;
+			int padding;
+			int step;
+			int steps;
+			unsigned long lastUpdate;
+			unsigned long changes;
+			bool smooth;
+			bool running;
+		} marquee;
+		/* Glyph uploads per device and step of the smooth marquee, 0 = off */
+		int smoothBudget;
+
+		/* Frames of the marquee steps, replayed when the same marquee runs again */
+		struct {
+			byte *buffer;
+			int size;
+			int used;
+			int read;
+			int steps;
+			int step;
+			unsigned long key;
+			bool recording;
+			bool replaying;
+			bool capture;
+			bool overflow;
+		} marqueeCache;
+		/* Counts every change of the shadow */
+		unsigned long shadowChanges;
+
+		/* Hash of the marquee text and settings */
+		unsigned long marqueeKey();
+		/* Send the digits of a marquee step, from the cache when possible */
+		void sendMarqueeStep();
+		/* Write a fixed point number right aligned into at least width characters,
+		 * returns the length. The buffer has MAX_NUMBER_LENGTH characters. */
+		static int formatNumber(char *buffer, long value, int width, int decimals);
+		static int formatNumber(char *buffer, unsigned long value, int width, int decimals);
+		static int formatNumber(char *buffer, unsigned long magnitude, bool negative, int width, int decimals);
+		static int formatNumber(char *buffer, double value, int width, int decimals);
+		/* Fit a formatted number into a window of characters: leading blanks
+		 * are dropped, a number still too long is shown as dashes. Returns the
+		 * new length. */
+		static int fitNumber(char *buffer, int length, int window);
+		/* Position of the marquee text at a step, shared with MAX6952Region */
+		static int marqueeOffset(int step, int steps, int padding, int mode, int direction);
+		/* Character of the marquee text, a blank outside of the text */
+		byte marqueeChar(int index);
+		/* Place the window of the smooth marquee which starts at column first */
+		void layoutSmooth(int first);
+		/* Queue the columns of a glyph unless the font cache has it in the slot */
+		bool queueGlyph(int device, int slot, const byte *glyph);
+		/* Slot of the glyph in the font cache of the device, -1 if not found */
+		int findGlyph(int device, const byte *glyph);
 
     public:
         /* 
-         * Create a new controler 
+         * Create a new controler on the SPI hardware of the board.
          * Params :
          * dataPin		pin on the Arduino where data gets shifted out
          * clockPin		pin for the clock
          * csPin		pin for selecting the device 
          * numDevices	maximum number of devices that can be controled
+         * buffer		DEVICE_BUFFER_SIZE(numDevices) bytes for the state of the
+         *				devices. If NULL the buffer is allocated once and never
+         *				freed, the controler is meant to live as long as the sketch.
+         *
+         * dataPin and clockPin have to be the MOSI and SCK pins of the board,
+         * use MAX6952BitBang for other pins.
+         *
+         * The buffer belongs to the caller, or to the controler if it was
+         * allocated. A copy of the controler, e.g. MAX6952 display = MAX6952(...),
+         * points to the same buffer: keep using only one of them.
          */
-        MAX6952(int dataPin, int clkPin, int csPin, int numDevices=1);
+        MAX6952(int dataPin, int clkPin, int csPin, int numDevices=1, byte *buffer=NULL);
+
+        /* 
+         * Create a new controler which sends the frames with a transport.
+         * Params :
+         * transport	MAX6952HardwareSPI, MAX6952BitBang, MAX6952Recorder or your own
+         * numDevices	maximum number of devices that can be controled
+         * buffer		DEVICE_BUFFER_SIZE(numDevices) bytes for the state of the
+         *				devices. If NULL the buffer is allocated once, see above.
+         */
+        MAX6952(MAX6952Transport &transport, int numDevices=1, byte *buffer=NULL);
 
         /*
          * Gets the number of devices attached to this MAX6952.
@@ -108,7 +342,8 @@ class MAX6952 {
         int getMaxTextLength();
 
         /* 
-         * Set the shutdown (power saving) mode for the device
+         * Set the shutdown (power saving) mode for the device. The devices
+         * are active after the constructor.
          * Params :
          * 
          * status	If true the device goes into power-down mode. Set to false
@@ -116,6 +351,112 @@ class MAX6952 {
          */
         void shutdown(bool status);
 
+        /* 
+         * Set the shutdown (power saving) mode for a single device.
+         * The other devices in the chain get a NOOP.
+         * Params :
+         * 
+         * device	index of the device in the chain (0 = first device),
+         *			ALL_DEVICES for every device
+         * status	If true the device goes into power-down mode. Set to false
+         *		for normal operation.
+         */
+        void shutdown(int device, bool status);
+
+		/* 
+         * Set the time CS is held high after each frame. The default of 1us
+         * is well above the minimum of the MAX6952, increase it only for
+         * long cables or slow level shifters.
+         * Params :
+         * 
+         * microseconds	guard time after each frame, 0 = none
+         */
+        void setFrameGuard(unsigned int microseconds);
+
+		/* 
+         * Set the SPI clock of the transport. With the SPI hardware every frame
+         * is sent in its own SPI transaction with this clock, so other devices
+         * on the bus keep their settings.
+         * Params :
+         * 
+         * hz			the clock in Hz, at most 26MHz (default 10MHz)
+         */
+        void setClock(unsigned long hz);
+
+		/* 
+         * Set a function which is called with every frame before it is sent,
+         * e.g. to log or check the data on the bus. The frame starts with
+         * the address and data for the last device in the chain.
+         * Params :
+         * 
+         * callback		the function, NULL to remove it
+         */
+        void setFrameCallback(void (*callback)(const byte *frame, int length));
+
+		/* 
+         * Returns :
+         * unsigned long	number of chip-select frames sent since resetBusStatistics()
+         */
+        unsigned long getFrameCount();
+
+		/* 
+         * Returns :
+         * unsigned long	number of bytes sent since resetBusStatistics()
+         */
+        unsigned long getByteCount();
+
+		/* 
+         * Returns :
+         * unsigned long	microseconds the library waited in delays since
+         *					resetBusStatistics(), e.g. the guard after each frame
+         *					and the time setTextMarquee() waits between the steps
+         */
+        unsigned long getBlockingMicros();
+
+		/* 
+         * Calculate the time the bus needed since resetBusStatistics().
+         * Params :
+         * 
+         * sckHz		the SPI clock in Hz
+         * Returns :
+         * unsigned long	microseconds for shifting all bytes plus the delays
+         */
+        unsigned long getBusMicros(unsigned long sckHz);
+
+		/* 
+         * Set the frame, byte, time and coalesced counters to 0.
+         */
+        void resetBusStatistics();
+
+		/* 
+         * Limit how often the text is sent. With an interval, setText(),
+         * setNumber(), setTextBlink() and writeDisplay() only change the
+         * buffer, service() sends it at most once per interval. Updates in
+         * between are merged, only the latest text is sent.
+         * Params :
+         * 
+         * milliseconds	time between two refreshes, e.g. 16 for 60Hz,
+         *				0 sends every update at once (default)
+         */
+        void setRefreshInterval(unsigned long milliseconds);
+
+		/* 
+         * Send the waiting update when the interval is over.
+         * Params :
+         * 
+         * now			the current time in milliseconds, normally millis()
+         * Returns :
+         * bool			true while an update is waiting
+         */
+        bool service(unsigned long now);
+
+		/* 
+         * Returns :
+         * unsigned long	number of updates since resetBusStatistics() which
+         *					were merged into a later one and not sent
+         */
+        unsigned long getCoalescedCount();
+
 		/* Set a specific register at MAX6952 
 		 *
 		 *
@@ -123,6 +464,42 @@ class MAX6952 {
 		 * data		data for register
 		 */
 		 void setRegister(byte addr, byte data );
+
+		/* Set a specific register at a single MAX6952. 
+		 * The other devices in the chain get a NOOP.
+		 *
+		 * device	index of the device in the chain (0 = first device)
+		 * addr		Address of the register
+		 * data		data for register
+		 */
+		 void setRegister(int device, byte addr, byte data );
+
+		/* 
+         * Queue a register write for one device. Queued writes are sent with
+         * sendQueue() in as few frames as possible, one write per device and
+         * frame. Devices without a write get a NOOP. The queue is sent
+         * automatically when it is full for a device.
+         * Params :
+         * 
+         * device		index of the device in the chain (0 = first device),
+         *				ALL_DEVICES for every device
+         * addr			Address of the register
+         * data			data for register
+         */
+        void queueRegister(int device, byte addr, byte data);
+
+		/* 
+         * Send all queued register writes.
+         */
+        void sendQueue();
+
+		/* 
+         * Send only the next frame of the queued register writes, e.g. to
+         * interleave the frames of several chains.
+         * Returns :
+         * bool			true while frames are left in the queue
+         */
+        bool sendQueueFrame();
        
         /* 
          * Set the brightness of the display.
@@ -132,6 +509,101 @@ class MAX6952 {
          */
         void setIntensity( int intensity);
 
+        /* 
+         * Set the brightness of a single digit or device.
+         * The other devices in the chain get a NOOP.
+         * Params:
+         * 
+         * device		index of the device in the chain (0 = first device),
+         *				ALL_DEVICES for every device
+         * digit		digit of the device (0..3), ALL_DIGITS for all four
+         * intensity	the brightness of the digit. (0..15)
+         */
+        void setIntensity(int device, int digit, int intensity);
+
+        /* 
+         * Set the brightness of a single character.
+         * Params:
+         * 
+         * position		index of the character (0..maxTextLength-1)
+         * intensity	the brightness of the character. (0..15)
+         */
+        void setDigitIntensity(int position, int intensity);
+
+        /* 
+         * Let single characters of the text blink, e.g. a cursor or an alarm
+         * value. Only the plane 1 registers of these characters are sent. The
+         * mask stays when setText() shows a new text and is removed by
+         * setTextBlink() and the marquee.
+         * Params:
+         * 
+         * position		index of the first character (0..maxTextLength-1)
+         * blink		true to blink, false for a steady character
+         * count		number of characters
+         */
+        void setDigitBlink(int position, bool blink, int count = 1);
+
+        /* 
+         * Start to fade the brightness without blocking. The fade is moved
+         * by calling updateFade() from the loop, the intensity registers are
+         * only sent when the level changes.
+         * Params:
+         * 
+         * device		index of the device in the chain, ALL_DEVICES for every device
+         * from			the brightness at the start (0..15)
+         * to			the brightness at the end (0..15)
+         * duration		duration of the fade in milliseconds
+         */
+        void fadeIntensity(int device, int from, int to, unsigned long duration);
+
+        /* 
+         * Set the brightness for the current time of the fade.
+         * Params:
+         * 
+         * now			the current time in milliseconds, normally millis()
+         * Returns :
+         * bool			true while the fade is running
+         */
+        bool updateFade(unsigned long now);
+
+        /* 
+         * Returns :
+         * bool			true while a fade is running
+         */
+        bool isFading();
+
+		/* 
+         * Upload user defined characters (5x7) to the font RAM. Each glyph
+         * has 5 bytes, one per column from left to right, bit 0 is the top row.
+         * The glyph in slot n is shown with the character USER_FONT_CHAR(n).
+         * Glyphs which are already in the font cache of a device are skipped.
+         * Params :
+         * 
+         * device		index of the device in the chain, ALL_DEVICES for every device
+         * slot			first slot to write (0..23)
+         * glyphs		5 bytes per glyph
+         * count		number of glyphs
+         * Returns :
+         * int			number of glyphs sent, summed over all devices
+         */
+        int setUserFont(int device, int slot, const byte *glyphs, int count = 1);
+
+		/* 
+         * Use a buffer of FONT_CACHE_SIZE(getDeviceCount()) bytes to remember
+         * the user defined fonts of all devices. Without a cache every glyph
+         * is sent by setUserFont().
+         * Params :
+         * 
+         * cache		the buffer, NULL to switch the cache off
+         */
+        void setFontCache(byte *cache);
+
+		/* 
+         * Forget the content of the font cache, e.g. after the devices were
+         * powered off. The next setUserFont() sends all glyphs again.
+         */
+        void invalidateUserFont();
+
         /* 
          * Switch all Leds on the display off. 
          * Params:
@@ -146,12 +618,45 @@ class MAX6952 {
          * 
          * text			the text to be displayed
          * position		left, right aligned or centered
+         * The text is placed into the display without using the heap.
          *  
          *		
          */
-        void setText(String text, int position);
+        void setText(const String &text, int position);
+        void setText(const char *text, int position);
+
+		/* 
+         * Set a Text with a given length to the Display both planes set
+         * Params :
+         * 
+         * text			the characters to be displayed
+         * length		the number of characters
+         * position		left, right aligned or centered
+         *		
+         */
+        void setText(const char *text, int length, int position);
 		
 		
+		/* 
+         * Show a number without String and without the heap. Only the digits
+         * which change are sent, on a counter mostly the last one or two.
+         * Params :
+         * 
+         * value		the number. An integer with decimals is a fixed point number,
+         *				setNumber(2350, 5, 2, RIGHT) shows "23.50". Unsigned
+         *				values use the whole range, e.g. a uint32_t counter.
+         * width		the number is right aligned in at least width characters.
+         *				Blanks which do not fit are dropped, a number wider than
+         *				the display is shown as dashes, never cut.
+         * decimals		digits after the point (0..6 for double)
+         * position		left, right aligned or centered on the display
+         */
+        void setNumber(int value, int width = 0, int decimals = 0, int position = RIGHT);
+        void setNumber(unsigned int value, int width = 0, int decimals = 0, int position = RIGHT);
+        void setNumber(long value, int width = 0, int decimals = 0, int position = RIGHT);
+        void setNumber(unsigned long value, int width = 0, int decimals = 0, int position = RIGHT);
+        void setNumber(double value, int width = 0, int decimals = 0, int position = RIGHT);
+
 		/* 
          * Set a Text to the Display in plane0.
 		 * Plane1 is blank to get blink effekt.
@@ -160,10 +665,11 @@ class MAX6952 {
          * 
          * text			the text to be displayed
          * position		left, right aligned or centered
-         * speed		blinking speed
+         * speed		BLINK_FAST or BLINK_SLOW
          *		
          */
-        void setTextBlink(String text,int speed, int position);
+        void setTextBlink(const String &text,int speed, int position);
+        void setTextBlink(const char *text,int speed, int position);
 		
 		
 		/* 
@@ -175,7 +681,77 @@ class MAX6952 {
          * speed		blinking speed
          *		
          */
-        void setTextMarquee(String text,int speed, int mode, int direction);
+        void setTextMarquee(const String &text,int speed, int mode, int direction);
+        void setTextMarquee(const char *text,int speed, int mode, int direction);
+
+		/* 
+         * Start a marquee without blocking. The marquee is moved by calling
+         * updateMarquee() from the loop.
+         * Params :
+         * 
+         * text			the text to be displayed
+         * speed		moving speed in milliseconds
+         * mode			CLASSIC or BOUNCE
+         * direction	0 = left to right, 1 = right to left
+         *
+         * The String is copied into a String inside the library, this
+         * allocates on the heap when the text is longer than the copy
+         * before. The char array is not copied and nothing is allocated,
+         * it must not change while the marquee is running.
+         *		
+         */
+        void startMarquee(const String &text,int speed, int mode, int direction);
+        void startMarquee(const char *text,int speed, int mode, int direction);
+
+		/* 
+         * Move the marquee by at most one step and return immediately.
+         * Params :
+         * 
+         * now			the current time in milliseconds, normally millis()
+         * Returns :
+         * bool			true while the marquee is running
+         *		
+         */
+        bool updateMarquee(unsigned long now);
+
+		/* 
+         * Returns :
+         * bool			true while the marquee is running
+         */
+        bool isMarqueeRunning();
+
+		/* 
+         * Stop the marquee at the current step.
+         */
+        void stopMarquee();
+
+		/* 
+         * Use a buffer to record the frames of the marquee steps. When the same
+         * text runs again with the same mode and direction, the frames are sent
+         * from the buffer instead of being built again. Only the digits which
+         * change from one step to the next are in the frames.
+         * Params :
+         * 
+         * buffer		the buffer, MARQUEE_CACHE_SIZE(devices, length) bytes for
+         *				all steps. A smaller buffer keeps the first steps.
+         *				NULL to switch the cache off.
+         * size			size of the buffer
+         */
+        void setMarqueeCache(byte *buffer, int size);
+
+		/* 
+         * Move the marquee by single columns instead of whole characters.
+         * Between two characters the digits show glyphs of the user defined
+         * font, all 24 slots are used for them. Glyphs which are already in
+         * the font cache (see setFontCache()) are not sent again.
+         * The speed of the marquee is the time per column.
+         * Params :
+         * 
+         * on			true for the smooth marquee
+         * uploadBudget	glyphs sent per device and step (1..4). A digit without
+         *				a glyph shows the nearest character.
+         */
+        void setSmoothScroll(bool on, int uploadBudget = 4);
 		
 		/* 
          * Set a Text to the Display
@@ -185,8 +761,96 @@ class MAX6952 {
          *		
          */
         void writeDisplay(char *  text);
+
+		/* 
+         * Set a single character in both planes. The display is not updated
+         * until flush() is called.
+         * Params :
+         * 
+         * position		index of the character (0..maxTextLength-1)
+         * c			the character
+         *		
+         */
+        void setChar(int position, char c);
+
+		/* 
+         * Send all digit registers which were changed since the last flush.
+         * Digits which did not change are not sent to the devices.
+         *		
+         */
+        void flush();
 		
 		
+		/* 
+         * Switch the double buffer mode on or off. In this mode setText()
+         * and writeDisplay() only draw into the buffer, present() shows
+         * the new content on all devices in the same moment.
+         * Params :
+         * 
+         * on			true to draw into the buffer, false sends the buffer
+         *				and returns to direct updates
+         */
+        void setDoubleBuffer(bool on);
+
+		/* 
+         * Show the content drawn since the last present(). The new digits
+         * go into the hidden plane 1 and the devices start to blink in sync.
+         * The new content appears at the change to plane 1, then updatePresent()
+         * copies it into plane 0 and stops the blink. Call updatePresent()
+         * from the loop until it returns false. What is drawn while the
+         * flip runs is shown by the next present().
+         */
+        void present();
+
+		/* 
+         * Finish the page flip when plane 1 is shown. Without the phase
+         * read back, the flip delay is counted from the first call.
+         * Params :
+         * 
+         * now			the current time in milliseconds, normally millis()
+         * Returns :
+         * bool			true while the page flip is running
+         */
+        bool updatePresent(unsigned long now);
+
+		/* 
+         * Returns :
+         * bool			true while a page flip is running
+         */
+        bool isPresenting();
+
+		/* 
+         * Set the time from the start of the blink to plane 1, half of the
+         * fast blink period. It depends on the oscillator of the devices.
+         * Params :
+         * 
+         * milliseconds	the time, default 500
+         */
+        void setFlipDelay(unsigned long milliseconds);
+		
+		/* 
+         * Restart the blink timing of all devices in the same frame.
+         */
+        void syncBlink();
+
+		/* 
+         * Read the blink phase from the devices. This needs MISO of the board
+         * connected to DOUT of the last device and a transport which can
+         * receive, like MAX6952HardwareSPI. With the phase, updatePresent()
+         * copies the digits as soon as plane 1 is shown.
+         * Params :
+         * 
+         * on			true if MISO is connected
+         */
+        void setPhaseReadBack(bool on);
+
+		/* 
+         * Returns :
+         * int			0 while plane 0 is shown, 1 while plane 1 is shown,
+         *				-1 if the phase can not be read
+         */
+        int getBlinkPhase();
+		
 		/* 
          * Set a Text to the Display in both planes. Display shows alternating both texts
          * Params :
@@ -194,12 +858,45 @@ class MAX6952 {
          * text1		the text to be displayed for plane1
 		 * text2		the text to be displayed for plane2
          * position		left, right aligned or centered
-         * speed		blinking speed
+         * speed		BLINK_FAST or BLINK_SLOW
+         *
+         * The devices switch between the texts by themselves, nothing is sent
+         * for a change. Only the digits which differ from the last texts are
+         * sent, a blink which is running keeps its phase.
          *		
          */
-        //void setTextBlink(String text1, String text2, int speed, int position);
+        void setTextBlink(const String &text1, const String &text2, int speed, int position);
+        void setTextBlink(const char *text1, const char *text2, int speed, int position);
 
         
+    /* Places text into the shadow of each chain and interleaves the flushes */
+    friend class MAX6952Group;
+    /* Places text into a part of the shadow */
+    friend class MAX6952Region;
+};
+
+
+/*
+ * A MAX6952 with the buffer for NumDevices inside the object.
+ * Nothing is allocated, the size of the object is known at compile time.
+ * It can not be copied, the copy would point into the buffer of the original.
+ *
+ *	MAX6952Static<8> max6952(23, 18, 5);
+ */
+template<int NumDevices>
+class MAX6952Static : public MAX6952 {
+    private :
+        byte deviceBuffer[DEVICE_BUFFER_SIZE(NumDevices)];
+
+    public:
+        MAX6952Static(int dataPin, int clkPin, int csPin)
+            : MAX6952(dataPin, clkPin, csPin, NumDevices, deviceBuffer) {}
+
+        MAX6952Static(MAX6952Transport &transport)
+            : MAX6952(transport, NumDevices, deviceBuffer) {}
+
+        MAX6952Static(const MAX6952Static &) = delete;
+        MAX6952Static &operator=(const MAX6952Static &) = delete;
 };
 
 #endif	//MAX6952.h
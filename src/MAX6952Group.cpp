@@ -0,0 +1,159 @@
+/*
+ *    MAX6952Group.cpp - Several MAX6952 chains as one display
+ *    Copyright (c) 2019 Kai Krause
+ *
+ *    Permission is hereby granted, free of charge, to any person
+ *    obtaining a copy of this software and associated documentation
+ *    files (the "Software"), to deal in the Software without
+ *    restriction, including without limitation the rights to use,
+ *    copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *    copies of the Software, and to permit persons to whom the
+ *    Software is furnished to do so, subject to the following
+ *    conditions:
+ *
+ *    This permission notice shall be included in all copies or
+ *    substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *    OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "MAX6952Group.h"
+
+
+
+MAX6952Group::MAX6952Group(MAX6952 **groupChains, int count) {
+
+	chains = groupChains;
+	chainCount = count;
+	maxTextLength = 0;
+
+	for(int c = 0; c < chainCount; c++){
+		maxTextLength += chains[c]->getMaxTextLength();
+	}
+}
+
+int MAX6952Group::getChainCount() {
+	return chainCount;
+}
+
+int MAX6952Group::getMaxTextLength() {
+	return maxTextLength;
+}
+
+void MAX6952Group::shutdown(bool b) {
+
+	for(int c = 0; c < chainCount; c++){
+		chains[c]->shutdown(b);
+	}
+}
+
+void MAX6952Group::setIntensity(int level) {
+
+	for(int c = 0; c < chainCount; c++){
+		chains[c]->setIntensity(level);
+	}
+}
+
+void MAX6952Group::setChar(int position, char ch) {
+
+	for(int c = 0; c < chainCount; c++){
+
+		int length = chains[c]->getMaxTextLength();
+
+		if(position >= 0 && position < length){
+			chains[c]->setChar(position, ch);
+			return;
+		}
+
+		position -= length;
+	}
+}
+
+void MAX6952Group::flush() {
+
+	for(int c = 0; c < chainCount; c++){
+		chains[c]->queueDirty();
+	}
+
+	sendInterleaved();
+}
+
+void MAX6952Group::sendInterleaved() {
+
+	/*
+	 * One frame of every chain per round. On a shared bus the chains are
+	 * updated side by side instead of one after the other, on separate
+	 * SPI hosts the rounds end when the longest queue is sent.
+	 */
+	bool pending = true;
+
+	while(pending){
+
+		pending = false;
+
+		for(int c = 0; c < chainCount; c++){
+			if(chains[c]->sendQueueFrame()){
+				pending = true;
+			}
+		}
+	}
+}
+
+void MAX6952Group::layoutText(int plane, const char *text, int length, int position) {
+
+	/* The chains are one window, the text is aligned in all of their characters */
+	int front = MAX6952::alignFront(maxTextLength, length, position);
+
+	int i = 0;
+
+	for(int c = 0; c < chainCount; c++){
+
+		MAX6952 *chain = chains[c];
+
+		for(int p = 0; p < chain->maxTextLength; p++, i++){
+
+			int index = i - front;
+
+			chain->putChar(p, plane, (index >= 0 && index < length) ? text[index] : ' ');
+		}
+	}
+}
+
+void MAX6952Group::setText(const String &inputText, int position) {
+
+	setText(inputText.c_str(), inputText.length(), position);
+}
+
+void MAX6952Group::setText(const char *inputText, int position) {
+
+	setText(inputText, strlen(inputText), position);
+}
+
+void MAX6952Group::setText(const char *inputText, int length, int position) {
+
+	layoutText(0, inputText, length, position);
+	layoutText(1, inputText, length, position);
+
+	/* The digits of the chains which send at once go out side by side */
+	for(int c = 0; c < chainCount; c++){
+		if(!chains[c]->doubleBuffer && chains[c]->refreshInterval == 0){
+			chains[c]->queueDirty();
+		}
+	}
+
+	sendInterleaved();
+
+	/* In double buffer mode the text waits for present() */
+	for(int c = 0; c < chainCount; c++){
+		if(!chains[c]->doubleBuffer){
+			chains[c]->requestRefresh(REFRESH_TEXT, 0);
+		}
+	}
+}
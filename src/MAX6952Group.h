@@ -0,0 +1,128 @@
+/*
+ *    MAX6952Group.h - Several MAX6952 chains as one display
+ *    Copyright (c) 2019 Kai Krause
+ *
+ *    Permission is hereby granted, free of charge, to any person
+ *    obtaining a copy of this software and associated documentation
+ *    files (the "Software"), to deal in the Software without
+ *    restriction, including without limitation the rights to use,
+ *    copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *    copies of the Software, and to permit persons to whom the
+ *    Software is furnished to do so, subject to the following
+ *    conditions:
+ *
+ *    This permission notice shall be included in all copies or
+ *    substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *    OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+ /* A group shows one text on several chains, each chain with its own CS
+  * line or its own SPI host. The first chain shows the first characters.
+  *
+  * A digit which changes only costs a frame on its own chain, which is much
+  * shorter than a frame on one long chain. The frames of the chains are sent
+  * in turns, so all chains are updated together.
+  *
+  *	MAX6952 left(23, 18, 5, 16);
+  *	MAX6952 right(23, 18, 4, 16);
+  *	MAX6952 *chains[] = { &left, &right };
+  *	MAX6952Group display(chains, 2);
+  */
+
+
+#ifndef MAX6952Group_h
+#define MAX6952Group_h
+
+#include "MAX6952.h"
+
+
+class MAX6952Group {
+    private :
+        /* The chains, the first one shows the first characters */
+        MAX6952 **chains;
+        /* Number of chains */
+        int chainCount;
+        /* The characters of all chains */
+        int maxTextLength;
+
+        /* Place a text into one plane of all chains, padded with blanks */
+        void layoutText(int plane, const char *text, int length, int position);
+        /* Send the queues of all chains, one frame of each chain in turn */
+        void sendInterleaved();
+
+    public:
+        /*
+         * Params :
+         * chains		the chains, the array is not copied
+         * count		number of chains
+         */
+        MAX6952Group(MAX6952 **chains, int count);
+
+        /*
+         * Returns :
+         * int	the number of chains
+         */
+        int getChainCount();
+
+        /*
+         * Returns :
+         * int	the number of digits of all chains
+         */
+        int getMaxTextLength();
+
+        /*
+         * Set the shutdown (power saving) mode of all chains.
+         * Params :
+         *
+         * status	If true the devices go into power-down mode
+         */
+        void shutdown(bool status);
+
+        /*
+         * Set the brightness of all chains.
+         * Params :
+         *
+         * intensity	the brightness of the display. (0..15)
+         */
+        void setIntensity(int intensity);
+
+        /*
+         * Set a single character in both planes. The display is not updated
+         * until flush() is called.
+         * Params :
+         *
+         * position		index of the character (0..maxTextLength-1)
+         * c			the character
+         */
+        void setChar(int position, char c);
+
+        /*
+         * Send the changed digits of all chains, one frame of each chain in turn.
+         */
+        void flush();
+
+        /*
+         * Set a Text to all chains, both planes set. Like MAX6952::setText(),
+         * a chain in double buffer mode waits for present() and a chain with
+         * a refresh interval for service().
+         * Params :
+         *
+         * text			the text to be displayed
+         * length		the number of characters
+         * position		left, right aligned or centered
+         */
+        void setText(const String &text, int position);
+        void setText(const char *text, int position);
+        void setText(const char *text, int length, int position);
+};
+
+#endif	//MAX6952Group.h
@@ -0,0 +1,220 @@
+/*
+ *    MAX6952Region.cpp - A part of the display with its own text
+ *    Copyright (c) 2019 Kai Krause
+ *
+ *    Permission is hereby granted, free of charge, to any person
+ *    obtaining a copy of this software and associated documentation
+ *    files (the "Software"), to deal in the Software without
+ *    restriction, including without limitation the rights to use,
+ *    copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *    copies of the Software, and to permit persons to whom the
+ *    Software is furnished to do so, subject to the following
+ *    conditions:
+ *
+ *    This permission notice shall be included in all copies or
+ *    substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *    OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "MAX6952Region.h"
+
+
+
+MAX6952Region::MAX6952Region(MAX6952 &regionDisplay, int regionFirst, int regionLength) {
+
+	display = &regionDisplay;
+
+	if(regionFirst < 0){
+		regionFirst = 0;
+	}
+
+	if(regionFirst > display->getMaxTextLength()){
+		regionFirst = display->getMaxTextLength();
+	}
+
+	if(regionLength > display->getMaxTextLength() - regionFirst){
+		regionLength = display->getMaxTextLength() - regionFirst;
+	}
+
+	if(regionLength < 0){
+		regionLength = 0;
+	}
+
+	first = regionFirst;
+	length = regionLength;
+	marquee.running = false;
+}
+
+int MAX6952Region::getLength() {
+	return length;
+}
+
+void MAX6952Region::setChar(int position, char c) {
+
+	if(position < 0 || position >= length){
+		return;
+	}
+
+	display->setChar(first + position, c);
+}
+
+void MAX6952Region::flush() {
+
+	/* Only the dirty digits are sent, and only this region changed them */
+	display->flush();
+}
+
+void MAX6952Region::setText(const String &inputText, int position) {
+
+	setText(inputText.c_str(), inputText.length(), position);
+}
+
+void MAX6952Region::setText(const char *inputText, int position) {
+
+	setText(inputText, strlen(inputText), position);
+}
+
+void MAX6952Region::setText(const char *inputText, int textLength, int position) {
+
+	marquee.running = false;
+
+	/* A running flip is finished first, unless the text waits for present() */
+	if(!display->doubleBuffer){
+		display->finishFlip();
+	}
+
+	display->layoutWindow(first, length, 0, inputText, textLength, position);
+	display->layoutWindow(first, length, 1, inputText, textLength, position);
+
+	/* In double buffer mode the text waits for present() */
+	if(display->doubleBuffer){
+		return;
+	}
+
+	display->requestRefresh(REFRESH_TEXT, 0);
+}
+
+void MAX6952Region::setNumber(int value, int width, int decimals, int position) {
+
+	setNumber((long)value, width, decimals, position);
+}
+
+void MAX6952Region::setNumber(long value, int width, int decimals, int position) {
+
+	char text[MAX_NUMBER_LENGTH];
+
+	int textLength = MAX6952::formatNumber(text, value, width, decimals);
+
+	setText(text, MAX6952::fitNumber(text, textLength, length), position);
+}
+
+void MAX6952Region::setNumber(unsigned int value, int width, int decimals, int position) {
+
+	setNumber((unsigned long)value, width, decimals, position);
+}
+
+void MAX6952Region::setNumber(unsigned long value, int width, int decimals, int position) {
+
+	char text[MAX_NUMBER_LENGTH];
+
+	int textLength = MAX6952::formatNumber(text, value, width, decimals);
+
+	setText(text, MAX6952::fitNumber(text, textLength, length), position);
+}
+
+void MAX6952Region::setNumber(double value, int width, int decimals, int position) {
+
+	char text[MAX_NUMBER_LENGTH];
+
+	int textLength = MAX6952::formatNumber(text, value, width, decimals);
+
+	setText(text, MAX6952::fitNumber(text, textLength, length), position);
+}
+
+void MAX6952Region::startMarquee(const char *inputText, int speed, int mode, int direction) {
+
+	int textLength = strlen(inputText);
+
+	if(mode == BOUNCE && textLength <= length){
+		marquee.padding = length - textLength;
+		marquee.steps = 2 * marquee.padding;
+	} else {
+		mode = CLASSIC;
+		marquee.padding = length;
+		marquee.steps = length + textLength;
+	}
+
+	marquee.text = inputText;
+	marquee.length = textLength;
+	marquee.speed = speed;
+	marquee.mode = mode;
+	marquee.direction = direction;
+	marquee.step = 0;
+	marquee.lastUpdate = 0;
+	marquee.running = (marquee.steps > 0);
+
+	if(!display->doubleBuffer){
+		display->finishFlip();
+		display->activateText();
+	}
+}
+
+bool MAX6952Region::updateMarquee(unsigned long now) {
+
+	if(!marquee.running){
+		return false;
+	}
+
+	if(marquee.step > 0 && (now - marquee.lastUpdate) < (unsigned long)marquee.speed){
+		return true;
+	}
+
+	if(marquee.step >= marquee.steps){
+		marquee.running = false;
+		return false;
+	}
+
+	int offset = MAX6952::marqueeOffset(marquee.step, marquee.steps, marquee.padding, marquee.mode, marquee.direction);
+
+	/* Text position of the first character in the region */
+	int start = offset - marquee.padding;
+
+	if(!display->doubleBuffer){
+		display->finishFlip();
+	}
+
+	for(int i = 0; i < length; i++){
+
+		int index = start + i;
+		byte c = (index >= 0 && index < marquee.length) ? marquee.text[index] : ' ';
+
+		display->putChar(first + i, 0, c);
+		display->putChar(first + i, 1, c);
+	}
+
+	/* In double buffer mode the steps are shown by present() */
+	if(!display->doubleBuffer){
+		display->flush();
+	}
+
+	marquee.step++;
+	marquee.lastUpdate = now;
+
+	return true;
+}
+
+bool MAX6952Region::isMarqueeRunning() {
+	return marquee.running;
+}
+
+void MAX6952Region::stopMarquee() {
+	marquee.running = false;
+}
@@ -0,0 +1,162 @@
+/*
+ *    MAX6952Region.h - A part of the display with its own text
+ *    Copyright (c) 2019 Kai Krause
+ *
+ *    Permission is hereby granted, free of charge, to any person
+ *    obtaining a copy of this software and associated documentation
+ *    files (the "Software"), to deal in the Software without
+ *    restriction, including without limitation the rights to use,
+ *    copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *    copies of the Software, and to permit persons to whom the
+ *    Software is furnished to do so, subject to the following
+ *    conditions:
+ *
+ *    This permission notice shall be included in all copies or
+ *    substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *    OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+ /* A region is a row of characters of a MAX6952, e.g. a static label and
+  * a ticker next to it. Each region has its own alignment and marquee.
+  * A region only changes its own characters, so the digits of the other
+  * regions are not sent again. In double buffer mode of the display the
+  * text and the marquee steps wait for present().
+  *
+  *	MAX6952 max6952(23, 18, 5, 16);
+  *	MAX6952Region label(max6952, 0, 12);
+  *	MAX6952Region ticker(max6952, 12, 52);
+  */
+
+
+#ifndef MAX6952Region_h
+#define MAX6952Region_h
+
+#include "MAX6952.h"
+
+
+class MAX6952Region {
+    private :
+        /* The display the region belongs to */
+        MAX6952 *display;
+        /* First character of the region on the display */
+        int first;
+        /* Number of characters */
+        int length;
+
+        /* State of the marquee driven by updateMarquee() */
+        struct {
+            const char *text;
+            int length;
+            int speed;
+            int mode;
+            int direction;
+            int padding;
+            int step;
+            int steps;
+            unsigned long lastUpdate;
+            bool running;
+        } marquee;
+
+    public:
+        /*
+         * Params :
+         * display		the display
+         * first		index of the first character of the region
+         * length		number of characters, cut at the end of the display
+         */
+        MAX6952Region(MAX6952 &display, int first, int length);
+
+        /*
+         * Returns :
+         * int	the number of characters of the region
+         */
+        int getLength();
+
+        /*
+         * Set a single character in both planes. The display is not updated
+         * until flush() is called.
+         * Params :
+         *
+         * position		index of the character in the region (0..length-1)
+         * c			the character
+         */
+        void setChar(int position, char c);
+
+        /*
+         * Send the changed digits. Digits of regions which did not change
+         * are not sent.
+         */
+        void flush();
+
+        /*
+         * Set a Text to the region, both planes set. A marquee of the region stops.
+         * Params :
+         *
+         * text			the text to be displayed
+         * length		the number of characters
+         * position		left, right aligned or centered in the region
+         */
+        void setText(const String &text, int position);
+        void setText(const char *text, int position);
+        void setText(const char *text, int length, int position);
+
+        /*
+         * Show a number in the region, see MAX6952::setNumber().
+         * Params :
+         *
+         * value		the number, an integer with decimals is a fixed point number
+         * width		the number is right aligned in at least width characters
+         * decimals		digits after the point (0..6 for double)
+         * position		left, right aligned or centered in the region
+         */
+        void setNumber(int value, int width = 0, int decimals = 0, int position = RIGHT);
+        void setNumber(unsigned int value, int width = 0, int decimals = 0, int position = RIGHT);
+        void setNumber(long value, int width = 0, int decimals = 0, int position = RIGHT);
+        void setNumber(unsigned long value, int width = 0, int decimals = 0, int position = RIGHT);
+        void setNumber(double value, int width = 0, int decimals = 0, int position = RIGHT);
+
+        /*
+         * Start a marquee inside the region without blocking. The marquee
+         * is moved by calling updateMarquee() from the loop.
+         * Params :
+         *
+         * text			the text, it is not copied and must not change
+         *				while the marquee is running
+         * speed		moving speed in milliseconds
+         * mode			CLASSIC or BOUNCE
+         * direction	0 = left to right, 1 = right to left
+         */
+        void startMarquee(const char *text, int speed, int mode, int direction);
+
+        /*
+         * Move the marquee by at most one step and return immediately.
+         * Params :
+         *
+         * now			the current time in milliseconds, normally millis()
+         * Returns :
+         * bool			true while the marquee is running
+         */
+        bool updateMarquee(unsigned long now);
+
+        /*
+         * Returns :
+         * bool			true while the marquee is running
+         */
+        bool isMarqueeRunning();
+
+        /*
+         * Stop the marquee at the current step.
+         */
+        void stopMarquee();
+};
+
+#endif	//MAX6952Region.h
@@ -0,0 +1,339 @@
+/*
+ *    MAX6952Transport.cpp - Bus transports for the MAX6952 library
+ *    Copyright (c) 2019 Kai Krause
+ *
+ *    Permission is hereby granted, free of charge, to any person
+ *    obtaining a copy of this software and associated documentation
+ *    files (the "Software"), to deal in the Software without
+ *    restriction, including without limitation the rights to use,
+ *    copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *    copies of the Software, and to permit persons to whom the
+ *    Software is furnished to do so, subject to the following
+ *    conditions:
+ *
+ *    This permission notice shall be included in all copies or
+ *    substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *    OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <SPI.h>
+#include "MAX6952Transport.h"
+
+#define MAX_SPI_CLOCK		26000000UL
+#define DEFAULT_SPI_CLOCK	10000000UL
+
+
+
+MAX6952HardwareSPI::MAX6952HardwareSPI(int csPin) {
+
+	SPI_CS = csPin;
+	spiClock = DEFAULT_SPI_CLOCK;
+	spi = &SPI;
+}
+
+MAX6952HardwareSPI::MAX6952HardwareSPI(int csPin, SPIClass &spiHost) {
+
+	SPI_CS = csPin;
+	spiClock = DEFAULT_SPI_CLOCK;
+	spi = &spiHost;
+}
+
+void MAX6952HardwareSPI::begin() {
+
+	spi->begin();
+
+	pinMode(SPI_CS,OUTPUT);
+	digitalWrite(SPI_CS, HIGH);
+}
+
+void MAX6952HardwareSPI::setClock(unsigned long hz) {
+
+	if(hz > MAX_SPI_CLOCK){
+		hz = MAX_SPI_CLOCK;
+	}
+
+	spiClock = hz;
+}
+
+void MAX6952HardwareSPI::write(byte *frame, int length) {
+
+	/* The MAX6952 samples DIN on the rising edge of CLK, MSB first */
+	spi->beginTransaction(SPISettings(spiClock, MSBFIRST, SPI_MODE0));
+	digitalWrite(SPI_CS, LOW);
+
+#if defined(ESP32)
+	/* The whole frame goes into the SPI FIFO, nothing is read back */
+	spi->writeBytes(frame, length);
+#else
+	/* The frame is overwritten with the received data */
+	spi->transfer(frame, length);
+#endif
+
+	digitalWrite(SPI_CS, HIGH);
+	spi->endTransaction();
+}
+
+bool MAX6952HardwareSPI::read(byte *frame, int length) {
+
+	spi->beginTransaction(SPISettings(spiClock, MSBFIRST, SPI_MODE0));
+	digitalWrite(SPI_CS, LOW);
+
+	/* MISO comes from DOUT of the last device */
+	spi->transfer(frame, length);
+
+	digitalWrite(SPI_CS, HIGH);
+	spi->endTransaction();
+
+	return true;
+}
+
+
+
+MAX6952BitBang::MAX6952BitBang(int dataPin, int clkPin, int csPin) {
+
+	SPI_MOSI = dataPin;
+	SPI_CLK = clkPin;
+	SPI_CS = csPin;
+}
+
+void MAX6952BitBang::begin() {
+
+	pinMode(SPI_MOSI,OUTPUT);
+	pinMode(SPI_CLK,OUTPUT);
+	pinMode(SPI_CS,OUTPUT);
+
+	digitalWrite(SPI_CLK, LOW);
+	digitalWrite(SPI_CS, HIGH);
+
+#if defined(portOutputRegister)
+	dataPort = portOutputRegister(digitalPinToPort(SPI_MOSI));
+	dataMask = digitalPinToBitMask(SPI_MOSI);
+	clkPort = portOutputRegister(digitalPinToPort(SPI_CLK));
+	clkMask = digitalPinToBitMask(SPI_CLK);
+	csPort = portOutputRegister(digitalPinToPort(SPI_CS));
+	csMask = digitalPinToBitMask(SPI_CS);
+#endif
+}
+
+void MAX6952BitBang::write(byte *frame, int length) {
+
+#if defined(portOutputRegister)
+
+	/* The pins are written directly to the port registers, much faster than digitalWrite() */
+	*csPort &= ~csMask;
+
+	for(int i = 0; i < length; i++){
+
+		byte value = frame[i];
+
+		for(byte bit = 0x80; bit != 0; bit >>= 1){
+
+			if(value & bit){
+				*dataPort |= dataMask;
+			} else {
+				*dataPort &= ~dataMask;
+			}
+
+			*clkPort |= clkMask;
+			*clkPort &= ~clkMask;
+		}
+	}
+
+	*csPort |= csMask;
+
+#else
+
+	digitalWrite(SPI_CS, LOW);
+
+	for(int i = 0; i < length; i++){
+		shiftOut(SPI_MOSI, SPI_CLK, MSBFIRST, frame[i]);
+	}
+
+	digitalWrite(SPI_CS, HIGH);
+
+#endif
+}
+
+
+
+MAX6952Recorder::MAX6952Recorder(byte *buffer, int size) {
+
+	data = buffer;
+	capacity = size;
+	clear();
+}
+
+void MAX6952Recorder::begin() {
+}
+
+void MAX6952Recorder::write(byte *frame, int count) {
+
+	frames++;
+
+	for(int i = 0; i < count; i++){
+
+		if(length < capacity){
+			data[length++] = frame[i];
+		} else {
+			overflow = true;
+		}
+	}
+}
+
+const byte *MAX6952Recorder::getData() {
+	return data;
+}
+
+int MAX6952Recorder::getLength() {
+	return length;
+}
+
+unsigned long MAX6952Recorder::getFrameCount() {
+	return frames;
+}
+
+bool MAX6952Recorder::isOverflow() {
+	return overflow;
+}
+
+void MAX6952Recorder::clear() {
+
+	length = 0;
+	frames = 0;
+	overflow = false;
+}
+
+
+
+#if defined(ESP32)
+
+#include <esp_heap_caps.h>
+
+MAX6952ESP32DMA::MAX6952ESP32DMA(int dataPin, int clkPin, int csPin, int numDevices, spi_host_device_t spiHost) {
+
+	SPI_MOSI = dataPin;
+	SPI_CLK = clkPin;
+	SPI_CS = csPin;
+	host = spiHost;
+	spiClock = DEFAULT_SPI_CLOCK;
+	device = NULL;
+	bufferSize = numDevices * 2;
+	next = 0;
+	queued = 0;
+
+	for(int i = 0; i < MAX6952_DMA_QUEUE; i++){
+		buffers[i] = NULL;
+	}
+}
+
+void MAX6952ESP32DMA::begin() {
+
+	spi_bus_config_t bus;
+
+	memset(&bus, 0, sizeof(bus));
+	bus.mosi_io_num = SPI_MOSI;
+	bus.miso_io_num = -1;
+	bus.sclk_io_num = SPI_CLK;
+	bus.quadwp_io_num = -1;
+	bus.quadhd_io_num = -1;
+	bus.max_transfer_sz = bufferSize;
+
+	/* A bus which is already set up by another chain is used as it is */
+	spi_bus_initialize(host, &bus, SPI_DMA_CH_AUTO);
+
+	/* The frame of the library is changed while the DMA still reads, so every queued frame has its own copy */
+	for(int i = 0; i < MAX6952_DMA_QUEUE; i++){
+		if(buffers[i] == NULL){
+			buffers[i] = (byte*)heap_caps_malloc(bufferSize, MALLOC_CAP_DMA);
+		}
+	}
+
+	addDevice();
+}
+
+void MAX6952ESP32DMA::addDevice() {
+
+	spi_device_interface_config_t config;
+
+	/* The MAX6952 samples DIN on the rising edge of CLK, MSB first */
+	memset(&config, 0, sizeof(config));
+	config.mode = 0;
+	config.clock_speed_hz = spiClock;
+	config.spics_io_num = SPI_CS;
+	config.queue_size = MAX6952_DMA_QUEUE;
+
+	if(spi_bus_add_device(host, &config, &device) != ESP_OK){
+		device = NULL;
+	}
+}
+
+void MAX6952ESP32DMA::setClock(unsigned long hz) {
+
+	if(hz > MAX_SPI_CLOCK){
+		hz = MAX_SPI_CLOCK;
+	}
+
+	spiClock = hz;
+
+	/* The driver keeps the clock per device, the device is added again */
+	if(device != NULL){
+		finish();
+		spi_bus_remove_device(device);
+		addDevice();
+	}
+}
+
+void MAX6952ESP32DMA::write(byte *frame, int length) {
+
+	if(device == NULL || length > bufferSize || buffers[next] == NULL){
+		return;
+	}
+
+	/*
+	 * The frames are sent in the order they were queued. When all buffers
+	 * are in use, the oldest one is the next buffer, so the wait for one
+	 * result frees it.
+	 */
+	if(queued == MAX6952_DMA_QUEUE){
+
+		spi_transaction_t *done;
+
+		spi_device_get_trans_result(device, &done, portMAX_DELAY);
+		queued--;
+	}
+
+	memcpy(buffers[next], frame, length);
+
+	spi_transaction_t *transaction = &transactions[next];
+
+	memset(transaction, 0, sizeof(spi_transaction_t));
+	transaction->length = length * 8;
+	transaction->tx_buffer = buffers[next];
+
+	/* CS goes low and high around each transaction, the driver releases it between two frames */
+	if(spi_device_queue_trans(device, transaction, portMAX_DELAY) == ESP_OK){
+		next = (next + 1) % MAX6952_DMA_QUEUE;
+		queued++;
+	}
+}
+
+void MAX6952ESP32DMA::finish() {
+
+	while(queued > 0){
+
+		spi_transaction_t *done;
+
+		spi_device_get_trans_result(device, &done, portMAX_DELAY);
+		queued--;
+	}
+}
+
+#endif
@@ -0,0 +1,276 @@
+/*
+ *    MAX6952Transport.h - Bus transports for the MAX6952 library
+ *    Copyright (c) 2019 Kai Krause
+ *
+ *    Permission is hereby granted, free of charge, to any person
+ *    obtaining a copy of this software and associated documentation
+ *    files (the "Software"), to deal in the Software without
+ *    restriction, including without limitation the rights to use,
+ *    copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *    copies of the Software, and to permit persons to whom the
+ *    Software is furnished to do so, subject to the following
+ *    conditions:
+ *
+ *    This permission notice shall be included in all copies or
+ *    substantial portions of the Software.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *    OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+ /* A transport sends one chip-select frame to the chain:
+  * CS low, all bytes MSB first, CS high.
+  *
+  * MAX6952HardwareSPI	the SPI hardware of the board
+  * MAX6952BitBang		any three pins, written directly to the port registers
+  * MAX6952Recorder		keeps the bytes in memory, nothing is sent
+  * MAX6952ESP32DMA		ESP32 only, queued DMA transfers which return at once
+  */
+
+
+#ifndef MAX6952Transport_h
+#define MAX6952Transport_h
+
+#if (ARDUINO >= 100)
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+
+#include <SPI.h>
+
+#if defined(ESP32)
+#include <driver/spi_master.h>
+#endif
+
+
+class MAX6952Transport {
+    public:
+        /*
+         * Prepare the pins and the bus. Called by the MAX6952 constructor.
+         */
+        virtual void begin() = 0;
+
+        /*
+         * Send one frame.
+         * Params :
+         *
+         * frame		the bytes, the content may be changed by the transport
+         * length		number of bytes
+         */
+        virtual void write(byte *frame, int length) = 0;
+
+        /*
+         * Send one frame and replace it with the bytes received at the same time.
+         * Params :
+         *
+         * frame		the bytes
+         * length		number of bytes
+         * Returns :
+         * bool			false if the transport can not receive, nothing is sent
+         */
+        virtual bool read(byte * /*frame*/, int /*length*/) { return false; }
+
+        /*
+         * Set the clock of the bus, if the transport supports it.
+         * Params :
+         *
+         * hz			the clock in Hz
+         */
+        virtual void setClock(unsigned long /*hz*/) {}
+};
+
+
+class MAX6952HardwareSPI : public MAX6952Transport {
+    private :
+        /* This one is driven LOW for chip selection */
+        int SPI_CS;
+        /* SPI clock in Hz used for every frame */
+        unsigned long spiClock;
+        /* The SPI host the frames are sent with */
+        SPIClass *spi;
+
+    public:
+        /*
+         * Params :
+         * csPin		pin for selecting the device, MOSI and CLK are the SPI pins of the board
+         */
+        MAX6952HardwareSPI(int csPin);
+
+        /*
+         * Params :
+         * csPin		pin for selecting the device
+         * spiHost		the SPI host, e.g. a second SPIClass on the ESP32
+         */
+        MAX6952HardwareSPI(int csPin, SPIClass &spiHost);
+
+        void begin();
+        void write(byte *frame, int length);
+        bool read(byte *frame, int length);
+        void setClock(unsigned long hz);
+};
+
+
+#if defined(portOutputRegister)
+#if defined(__AVR__)
+typedef volatile uint8_t MAX6952PortReg;
+typedef uint8_t MAX6952PortMask;
+#else
+typedef volatile uint32_t MAX6952PortReg;
+typedef uint32_t MAX6952PortMask;
+#endif
+#endif
+
+class MAX6952BitBang : public MAX6952Transport {
+    private :
+        /* Data is shifted out of this pin*/
+        int SPI_MOSI;
+        /* The clock is signaled on this pin */
+        int SPI_CLK;
+        /* This one is driven LOW for chip selection */
+        int SPI_CS;
+
+#if defined(portOutputRegister)
+        /* Output registers and bit masks of the pins */
+        MAX6952PortReg *dataPort;
+        MAX6952PortMask dataMask;
+        MAX6952PortReg *clkPort;
+        MAX6952PortMask clkMask;
+        MAX6952PortReg *csPort;
+        MAX6952PortMask csMask;
+#endif
+
+    public:
+        /*
+         * Params :
+         * dataPin		pin where data gets shifted out
+         * clkPin		pin for the clock
+         * csPin		pin for selecting the device
+         */
+        MAX6952BitBang(int dataPin, int clkPin, int csPin);
+
+        void begin();
+        void write(byte *frame, int length);
+};
+
+
+class MAX6952Recorder : public MAX6952Transport {
+    private :
+        byte *data;
+        int capacity;
+        int length;
+        unsigned long frames;
+        bool overflow;
+
+    public:
+        /*
+         * Params :
+         * buffer		memory for the recorded bytes
+         * size			size of the buffer
+         */
+        MAX6952Recorder(byte *buffer, int size);
+
+        void begin();
+        void write(byte *frame, int count);
+
+        /*
+         * Returns :
+         * const byte *	the recorded bytes, frame after frame
+         */
+        const byte *getData();
+
+        /*
+         * Returns :
+         * int			number of recorded bytes
+         */
+        int getLength();
+
+        /*
+         * Returns :
+         * unsigned long	number of frames, also those which did not fit
+         */
+        unsigned long getFrameCount();
+
+        /*
+         * Returns :
+         * bool			true if bytes were lost because the buffer was full
+         */
+        bool isOverflow();
+
+        /*
+         * Forget all recorded bytes.
+         */
+        void clear();
+};
+
+#if defined(ESP32)
+
+/* Frames MAX6952ESP32DMA can have queued at the same time */
+#ifndef MAX6952_DMA_QUEUE
+#define MAX6952_DMA_QUEUE	4
+#endif
+
+class MAX6952ESP32DMA : public MAX6952Transport {
+    private :
+        /* Data is shifted out of this pin*/
+        int SPI_MOSI;
+        /* The clock is signaled on this pin */
+        int SPI_CLK;
+        /* This one is driven LOW by the SPI host for chip selection */
+        int SPI_CS;
+        /* The SPI host of the ESP-IDF driver, not used by SPIClass */
+        spi_host_device_t host;
+        /* SPI clock in Hz used for every frame */
+        unsigned long spiClock;
+        /* The chain on the bus, NULL until begin() */
+        spi_device_handle_t device;
+        /* One transaction and one DMA capable buffer per queued frame, used in turns */
+        spi_transaction_t transactions[MAX6952_DMA_QUEUE];
+        byte *buffers[MAX6952_DMA_QUEUE];
+        /* Bytes of each buffer, 2 per device */
+        int bufferSize;
+        /* The buffer for the next frame */
+        int next;
+        /* Frames queued and not yet taken back from the driver */
+        int queued;
+
+        /* Add the chain to the bus with the current clock */
+        void addDevice();
+
+    public:
+        /*
+         * Params :
+         * dataPin		pin where data gets shifted out
+         * clkPin		pin for the clock
+         * csPin		pin for selecting the device, driven by the SPI host
+         * numDevices	number of devices in the chain, sizes the DMA buffers
+         * spiHost		SPI host of the ESP-IDF driver, it must not be used by
+         *				SPIClass, e.g. SPI2_HOST (HSPI) on the ESP32
+         */
+        MAX6952ESP32DMA(int dataPin, int clkPin, int csPin, int numDevices, spi_host_device_t spiHost = SPI2_HOST);
+
+        void begin();
+
+        /*
+         * Copy the frame into a DMA buffer and queue it. Returns at once
+         * while less than MAX6952_DMA_QUEUE frames are on the bus.
+         */
+        void write(byte *frame, int length);
+        void setClock(unsigned long hz);
+
+        /*
+         * Wait until all queued frames are sent.
+         */
+        void finish();
+};
+
+#endif
+
+#endif	//MAX6952Transport.h
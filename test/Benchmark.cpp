@@ -0,0 +1,17 @@
+/*
+ *    Benchmark.cpp - The BenchmarkMAX6952 example on a PC.
+ *
+ *    The frames go to the SPI stub, the counters of the library are the
+ *    same as on a board. wall_us is the time of the PC.
+ */
+
+#include <Arduino.h>
+
+#include "../examples/BenchmarkMAX6952/BenchmarkMAX6952.ino"
+
+int main() {
+
+	setup();
+
+	return 0;
+}
@@ -0,0 +1,157 @@
+/*
+ *    ChainModel.cpp - A chain of MAX6952 on the PC, for the tests.
+ */
+
+#include "ChainModel.h"
+
+unsigned long ChainModel::sequence = 0;
+
+ChainModel::ChainModel(int numDevices) : device(numDevices) {
+
+	devices = numDevices;
+	readAddress = 0;
+	phase = 0;
+	canRead = false;
+
+	for(int j = 0; j < devices; j++){
+		DeviceModel &d = device[j];
+		memset(&d, 0, sizeof(d));
+		memset(d.plane0, ' ', 4);
+		memset(d.plane1, ' ', 4);
+	}
+
+	clear();
+}
+
+void ChainModel::begin() {
+}
+
+void ChainModel::clear() {
+
+	bytes.clear();
+	order.clear();
+	frames = 0;
+	errors = 0;
+}
+
+void ChainModel::write(byte *frame, int length) {
+
+	frames++;
+	order.push_back(sequence++);
+	bytes.insert(bytes.end(), frame, frame + length);
+
+	if(length != devices * 2){
+		errors++;
+		return;
+	}
+
+	readAddress = 0;
+
+	for(int j = 0; j < devices; j++){
+
+		byte addr = frame[(devices - 1 - j) * 2];
+		byte data = frame[((devices - 1 - j) * 2) + 1];
+
+		/* Only the last device is read, its DOUT is MISO */
+		if(addr & 0x80){
+			if(j == devices - 1){
+				readAddress = addr & 0x7F;
+			} else {
+				errors++;
+			}
+			continue;
+		}
+
+		decode(device[j], addr, data);
+	}
+}
+
+bool ChainModel::read(byte *frame, int length) {
+
+	if(!canRead){
+		return false;
+	}
+
+	byte addr = readAddress;
+
+	write(frame, length);
+
+	/* The last device shifts out the register it was asked for in the frame before */
+	memset(frame, 0x00, length);
+
+	if(addr == 0x04){
+		frame[0] = addr;
+		frame[1] = device[devices - 1].config | (phase ? 0x00 : 0x80);
+	}
+
+	return true;
+}
+
+void ChainModel::decode(DeviceModel &d, byte addr, byte data) {
+
+	if(addr >= 0x20 && addr <= 0x23){
+		d.plane0[addr - 0x20] = data;
+	} else if(addr >= 0x40 && addr <= 0x43){
+		d.plane1[addr - 0x40] = data;
+	} else if(addr >= 0x60 && addr <= 0x63){
+		d.plane0[addr - 0x60] = data;
+		d.plane1[addr - 0x60] = data;
+	} else {
+
+		switch(addr){
+			case 0x00:
+				break;
+
+			case 0x01:
+				d.intensity10 = data;
+				break;
+
+			case 0x02:
+				d.intensity32 = data;
+				break;
+
+			case 0x03:
+				d.scanLimit = data;
+				break;
+
+			case 0x04:
+				/* T and R are actions, only S, B and E are kept */
+				d.config = data & 0x0D;
+				if(data & 0x20){
+					memset(d.plane0, ' ', 4);
+					memset(d.plane1, ' ', 4);
+				}
+				break;
+
+			case 0x05:
+				if(data & 0x80){
+					d.fontPointer = data & 0x7F;
+				} else {
+					d.font[d.fontPointer] = data;
+					d.fontPointer = (d.fontPointer + 1) & 0x7F;
+				}
+				break;
+
+			case 0x07:
+				d.displayTest = data;
+				break;
+
+			default:
+				errors++;
+				break;
+		}
+	}
+}
+
+std::string ChainModel::text(int plane) {
+
+	std::string result;
+
+	for(int j = 0; j < devices; j++){
+		for(int digit = 0; digit < 4; digit++){
+			result += (char)(plane ? device[j].plane1[digit] : device[j].plane0[digit]);
+		}
+	}
+
+	return result;
+}
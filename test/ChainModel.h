@@ -0,0 +1,65 @@
+/*
+ *    ChainModel.h - A chain of MAX6952 on the PC, for the tests.
+ *
+ *    It is a transport: every frame is decoded into the registers of the
+ *    devices, the first word of a frame goes to the last device. All bytes
+ *    are kept, so a test can compare the traffic byte by byte.
+ */
+
+#ifndef ChainModel_h
+#define ChainModel_h
+
+#include <MAX6952.h>
+#include <vector>
+#include <string>
+
+struct DeviceModel {
+	byte plane0[4];
+	byte plane1[4];
+	byte config;
+	byte intensity10;
+	byte intensity32;
+	byte scanLimit;
+	byte displayTest;
+	byte font[128];
+	byte fontPointer;
+};
+
+class ChainModel : public MAX6952Transport {
+    private :
+        int devices;
+        /* Register of the last device which was read, 0 = none */
+        byte readAddress;
+
+        void decode(DeviceModel &device, byte addr, byte data);
+
+    public:
+        std::vector<DeviceModel> device;
+        /* Every byte on the bus, frame after frame */
+        std::vector<byte> bytes;
+        unsigned long frames;
+        /* Number of each frame among the frames of all models, shows the
+         * order in which several chains were written */
+        std::vector<unsigned long> order;
+        static unsigned long sequence;
+        /* Frames with a wrong length or an unknown register */
+        unsigned long errors;
+        /* Blink phase the last device reads back, 0 or 1 */
+        int phase;
+        /* read() works like MISO connected to DOUT of the last device */
+        bool canRead;
+
+        ChainModel(int numDevices);
+
+        void begin();
+        void write(byte *frame, int length);
+        bool read(byte *frame, int length);
+
+        /* Forget the recorded bytes, frames and their order, the registers stay */
+        void clear();
+
+        /* The characters of a plane of all devices, in text order */
+        std::string text(int plane);
+};
+
+#endif	//ChainModel.h
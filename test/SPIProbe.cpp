@@ -0,0 +1,90 @@
+/*
+ *    SPIProbe.cpp - Watches the SPI bus and the CS pin of the stubs, for the tests.
+ */
+
+#include "SPIProbe.h"
+
+SPIProbe::SPIProbe(ChainModel &chain, uint8_t pin) : model(chain) {
+
+	csPin = pin;
+	selected = false;
+	transactions = 0;
+	transactionCount = 0;
+	selects = 0;
+	deselects = 0;
+	clock = 0;
+	errors = 0;
+
+	setPinListener(this);
+	SPI.listener = this;
+}
+
+SPIProbe::~SPIProbe() {
+
+	setPinListener(NULL);
+	SPI.listener = NULL;
+}
+
+void SPIProbe::pinWritten(uint8_t pin, uint8_t value) {
+
+	if(pin != csPin){
+		return;
+	}
+
+	if(value == LOW){
+
+		/* The settings of the transaction must be active before CS goes low */
+		if(selected || transactions != 1){
+			errors++;
+		}
+
+		selected = true;
+		selects++;
+		frame.clear();
+		return;
+	}
+
+	/* CS high latches the frame, also the idle level from begin() */
+	if(!selected){
+		return;
+	}
+
+	if(transactions != 1){
+		errors++;
+	}
+
+	selected = false;
+	deselects++;
+	model.write(frame.data(), frame.size());
+}
+
+void SPIProbe::beginTransaction(uint32_t transactionClock) {
+
+	if(transactions != 0){
+		errors++;
+	}
+
+	transactions++;
+	transactionCount++;
+	clock = transactionClock;
+}
+
+void SPIProbe::endTransaction() {
+
+	/* CS goes high before the bus is given back */
+	if(transactions != 1 || selected){
+		errors++;
+	}
+
+	transactions--;
+}
+
+void SPIProbe::transfer(const uint8_t *data, size_t count) {
+
+	if(!selected){
+		errors++;
+		return;
+	}
+
+	frame.insert(frame.end(), data, data + count);
+}
@@ -0,0 +1,46 @@
+/*
+ *    SPIProbe.h - Watches the SPI bus and the CS pin of the stubs, for the tests.
+ *
+ *    The bytes sent while CS is low make one frame, which goes to a
+ *    ChainModel when CS goes high. Everything the MAX6952 would not accept
+ *    counts as an error: CS low outside of a transaction, bytes while CS is
+ *    high, nested or unbalanced transactions.
+ */
+
+#ifndef SPIProbe_h
+#define SPIProbe_h
+
+#include <SPI.h>
+#include <vector>
+#include "ChainModel.h"
+
+class SPIProbe : public PinListener, public SPIListener {
+    private :
+        ChainModel &model;
+        uint8_t csPin;
+        bool selected;
+        std::vector<byte> frame;
+
+    public:
+        /* Open transactions, 0 or 1 */
+        int transactions;
+        /* Transactions begun since the start */
+        unsigned long transactionCount;
+        /* Falling and rising edges of CS */
+        unsigned long selects;
+        unsigned long deselects;
+        /* Clock of the last transaction */
+        uint32_t clock;
+        unsigned long errors;
+
+        /* Registers itself with the stubs, until the destructor */
+        SPIProbe(ChainModel &chain, uint8_t pin);
+        ~SPIProbe();
+
+        void pinWritten(uint8_t pin, uint8_t value);
+        void beginTransaction(uint32_t clock);
+        void endTransaction();
+        void transfer(const uint8_t *data, size_t count);
+};
+
+#endif	//SPIProbe.h
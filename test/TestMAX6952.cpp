@@ -0,0 +1,1059 @@
+/*
+ *    TestMAX6952.cpp - Tests of the bytes the library sends to a chain.
+ *
+ *    Every test drives a ChainModel, which decodes each frame into the
+ *    registers of the devices. Run all tests, or one by its name:
+ *
+ *    ./test_max6952 [name]
+ */
+
+#include <MAX6952.h>
+#include <MAX6952Group.h>
+#include <MAX6952Region.h>
+#include <MAX6952Font.h>
+#include <stdio.h>
+#include <new>
+#include <chrono>
+#include <type_traits>
+#include "ChainModel.h"
+#include "SPIProbe.h"
+
+static int failures = 0;
+
+/* Every operator new is counted, the library must not use the heap */
+static unsigned long allocations = 0;
+
+void *operator new(size_t size) {
+
+	allocations++;
+
+	void *memory = malloc(size ? size : 1);
+
+	if(memory == NULL){
+		throw std::bad_alloc();
+	}
+
+	return memory;
+}
+
+void operator delete(void *memory) noexcept {
+	free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept {
+	free(memory);
+}
+
+#define CHECK(condition)	check((condition), #condition, __FILE__, __LINE__)
+
+static void check(bool ok, const char *condition, const char *file, int line) {
+
+	if(!ok){
+		printf("%s:%d: CHECK(%s) failed\n", file, line, condition);
+		failures++;
+	}
+}
+
+/* The bytes of some frames, written as int for readability */
+static std::vector<byte> bytes(std::initializer_list<int> values) {
+
+	std::vector<byte> result;
+
+	for(int value : values){
+		result.push_back((byte)value);
+	}
+
+	return result;
+}
+
+/* A display on a chain model, active and with all digits sent */
+struct Chain {
+	ChainModel model;
+	std::vector<byte> buffer;
+	MAX6952 display;
+
+	Chain(int devices) : model(devices), buffer(DEVICE_BUFFER_SIZE(devices)), display(model, devices, &buffer[0]) {
+		display.shutdown(false);
+		display.setText("", LEFT);
+		model.clear();
+	}
+};
+
+
+static void testShadowFlush() {
+
+	Chain chain(2);
+
+	chain.display.setText("ABCDEFGH", LEFT);
+	CHECK(chain.model.text(0) == "ABCDEFGH");
+	CHECK(chain.model.text(1) == "ABCDEFGH");
+	CHECK(chain.model.errors == 0);
+
+	/* The same text again sends nothing */
+	chain.model.clear();
+	chain.display.setText("ABCDEFGH", LEFT);
+	CHECK(chain.model.frames == 0);
+
+	/* One changed character is one word, the other device gets a NOOP */
+	chain.display.setText("ABCDEFGX", LEFT);
+	CHECK(chain.model.bytes == bytes({0x63, 'X', 0x00, 0x00}));
+
+	/* Changes of both devices share the frame */
+	chain.model.clear();
+	chain.display.setChar(0, 'Z');
+	chain.display.setChar(4, 'Y');
+	CHECK(chain.model.frames == 0);
+	chain.display.flush();
+	CHECK(chain.model.bytes == bytes({0x60, 'Y', 0x60, 'Z'}));
+	CHECK(chain.model.text(0) == "ZBCDYFGX");
+
+	/* A plane alone goes to its own register */
+	chain.model.clear();
+	chain.display.setTextBlink("ZBCDYFGX", "ZBCDYFGQ", BLINK_FAST, LEFT);
+	CHECK(chain.model.bytes[0] == 0x43 && chain.model.bytes[1] == 'Q');
+	CHECK(chain.model.text(0) == "ZBCDYFGX");
+	CHECK(chain.model.text(1) == "ZBCDYFGQ");
+}
+
+static void testQueuePacking() {
+
+	Chain chain(2);
+
+	/* Frame k carries the k-th write of every device, the first word is for the last device */
+	chain.display.queueRegister(0, 0x01, 0x11);
+	chain.display.queueRegister(0, 0x02, 0x22);
+	chain.display.queueRegister(1, 0x01, 0x33);
+	CHECK(chain.model.frames == 0);
+	chain.display.sendQueue();
+	CHECK(chain.model.bytes == bytes({0x01, 0x33, 0x01, 0x11,  0x00, 0x00, 0x02, 0x22}));
+
+	chain.model.clear();
+	chain.display.queueRegister(ALL_DEVICES, 0x01, 0x44);
+	chain.display.sendQueue();
+	CHECK(chain.model.bytes == bytes({0x01, 0x44, 0x01, 0x44}));
+
+	/* A full queue is sent before the next write */
+	chain.model.clear();
+	for(int i = 0; i <= MAX_QUEUE_DEPTH; i++){
+		chain.display.queueRegister(1, 0x01, i);
+	}
+	CHECK(chain.model.frames == MAX_QUEUE_DEPTH);
+	chain.display.sendQueue();
+	CHECK(chain.model.frames == MAX_QUEUE_DEPTH + 1);
+	CHECK(chain.model.device[1].intensity10 == MAX_QUEUE_DEPTH);
+
+	/* setIntensity only sends the registers which change */
+	chain.model.clear();
+	chain.display.setIntensity(ALL_DEVICES, 0, 5);
+	CHECK(chain.model.bytes == bytes({0x01, 0x05, 0x01, 0x05}));
+	chain.model.clear();
+	chain.display.setIntensity(ALL_DEVICES, 0, 5);
+	CHECK(chain.model.frames == 0);
+}
+
+static void testBlink() {
+
+	Chain chain(2);
+
+	/* Both planes first, then the blink starts on all devices in one frame */
+	chain.display.setTextBlink("ABCDEFGH", "WXYZ", BLINK_SLOW, LEFT);
+	CHECK(chain.model.text(0) == "ABCDEFGH");
+	CHECK(chain.model.text(1) == "WXYZ    ");
+	CHECK(chain.model.device[0].config == 0x0D);
+	CHECK(chain.model.device[1].config == 0x0D);
+
+	int length = chain.model.bytes.size();
+	CHECK(std::vector<byte>(chain.model.bytes.end() - 4, chain.model.bytes.end()) == bytes({0x04, 0x1D, 0x04, 0x1D}));
+	CHECK(length % 4 == 0);
+
+	/* A running blink keeps its phase, only the digits are sent */
+	chain.model.clear();
+	chain.display.setTextBlink("ABCDEFGH", "WXYQ", BLINK_SLOW, LEFT);
+	CHECK(chain.model.bytes == bytes({0x00, 0x00, 0x43, 'Q'}));
+
+	/* Back to steady text */
+	chain.model.clear();
+	chain.display.setText("12345678", LEFT);
+	CHECK(chain.model.text(1) == "12345678");
+	CHECK(chain.model.device[0].config == 0x05);
+	CHECK(chain.model.device[1].config == 0x05);
+
+	/* A single blinking character is blank in plane 1 */
+	chain.model.clear();
+	chain.display.setDigitBlink(5, true);
+	CHECK(std::vector<byte>(chain.model.bytes.begin(), chain.model.bytes.begin() + 4) == bytes({0x41, ' ', 0x00, 0x00}));
+	CHECK(chain.model.text(0) == "12345678");
+	CHECK(chain.model.text(1) == "12345 78");
+	CHECK((chain.model.device[0].config & 0x08) && (chain.model.device[1].config & 0x08));
+
+	/* The mask stays with a new text */
+	chain.display.setText("ABCDEFGH", LEFT);
+	CHECK(chain.model.text(0) == "ABCDEFGH");
+	CHECK(chain.model.text(1) == "ABCDE GH");
+
+	chain.display.setDigitBlink(5, false);
+	CHECK(chain.model.text(1) == "ABCDEFGH");
+	CHECK(chain.model.device[0].config == 0x05);
+
+	/* A digit without a mask is not touched, the blink of setTextBlink() stays */
+	chain.display.setTextBlink("ABCD", "WXYZ", BLINK_SLOW, LEFT);
+	chain.model.clear();
+	chain.display.setDigitBlink(0, false);
+	chain.display.setDigitBlink(4, false, 4);
+	CHECK(chain.model.frames == 0);
+	CHECK(chain.model.text(1) == "WXYZ    ");
+	CHECK(chain.model.device[0].config == 0x0D);
+
+	chain.display.setDigitBlink(1, true);
+	CHECK(chain.model.text(0) == "ABCD    ");
+	CHECK(chain.model.text(1) == "W YZ    ");
+	CHECK(chain.model.device[0].config == 0x0D);
+	CHECK(chain.model.device[1].config == 0x0D);
+	chain.display.setDigitBlink(1, false);
+	CHECK(chain.model.device[0].config == 0x0D);
+	CHECK(chain.model.errors == 0);
+}
+
+static void testPresent() {
+
+	Chain chain(2);
+
+	chain.display.setText("OLD TEXT", LEFT);
+	chain.display.setDoubleBuffer(true);
+	chain.model.clear();
+
+	chain.display.setText("NEW TEXT", LEFT);
+	CHECK(chain.model.frames == 0);
+
+	/* The new digits go into plane 1, the blink starts in sync */
+	chain.display.present();
+	CHECK(chain.model.text(0) == "OLD TEXT");
+	CHECK(chain.model.text(1) == "NEW TEXT");
+	CHECK(std::vector<byte>(chain.model.bytes.end() - 4, chain.model.bytes.end()) == bytes({0x04, 0x19, 0x04, 0x19}));
+	CHECK(chain.display.isPresenting());
+
+	/* The flip delay starts with the first updatePresent(), the clock of the caller is used */
+	unsigned long now = 100000;
+
+	CHECK(chain.display.updatePresent(now));
+	CHECK(chain.display.updatePresent(now + 500));
+	CHECK(chain.model.text(0) == "OLD TEXT");
+
+	/* After the change to plane 1 the digits are copied and the blink stops */
+	CHECK(!chain.display.updatePresent(now + 600));
+	CHECK(chain.model.text(0) == "NEW TEXT");
+	CHECK(chain.model.device[0].config == 0x01);
+	CHECK(chain.model.device[1].config == 0x01);
+
+	/* With the phase read back the flip ends as soon as plane 1 is shown */
+	chain.model.canRead = true;
+	chain.display.setPhaseReadBack(true);
+	chain.display.setText("PHASE 01", LEFT);
+	chain.display.present();
+
+	chain.model.phase = 0;
+	CHECK(chain.display.updatePresent(now));
+	chain.model.phase = 1;
+	CHECK(!chain.display.updatePresent(now));
+	CHECK(chain.model.text(0) == "PHASE 01");
+
+	/* Drawing during the flip is not shown before the next present() */
+	chain.display.setText("BBBBBBBB", LEFT);
+	chain.display.present();
+	chain.display.setText("CCCCCCCC", LEFT);
+	chain.model.phase = 1;
+	while(chain.display.updatePresent(now)){
+	}
+	CHECK(chain.model.text(0) == "BBBBBBBB");
+	CHECK(chain.model.text(1) == "BBBBBBBB");
+	CHECK(chain.model.device[0].config == 0x01);
+
+	chain.display.present();
+	CHECK(chain.model.text(1) == "CCCCCCCC");
+	CHECK(!chain.display.updatePresent(now));
+	CHECK(chain.model.text(0) == "CCCCCCCC");
+
+	/* The same text again has nothing to present */
+	chain.model.clear();
+	chain.display.setText("CCCCCCCC", LEFT);
+	chain.display.present();
+	CHECK(chain.model.frames == 0);
+	CHECK(!chain.display.isPresenting());
+	CHECK(chain.model.errors == 0);
+}
+
+static void testMarquee() {
+
+	Chain chain(1);
+	const char *expected[] = {"    ", "   A", "  AB", " AB ", "AB  ", "B   "};
+	unsigned long now = 1000;
+
+	chain.display.startMarquee("AB", 10, CLASSIC, RIGHT_TO_LEFT);
+
+	for(int step = 0; step < 6; step++){
+
+		CHECK(chain.display.updateMarquee(now));
+		CHECK(chain.model.text(0) == expected[step]);
+		CHECK(chain.model.text(1) == expected[step]);
+
+		/* Nothing moves before the speed is over */
+		unsigned long frames = chain.model.frames;
+		CHECK(chain.display.updateMarquee(now + 5));
+		CHECK(chain.model.frames == frames);
+
+		now += 10;
+	}
+
+	CHECK(!chain.display.updateMarquee(now));
+	CHECK(!chain.display.isMarqueeRunning());
+
+	/* BOUNCE moves between the borders and back */
+	const char *bounce[] = {"  AB", " AB ", "AB  ", " AB "};
+
+	chain.display.startMarquee("AB", 10, BOUNCE, RIGHT_TO_LEFT);
+
+	for(int step = 0; step < 4; step++){
+		CHECK(chain.display.updateMarquee(now));
+		CHECK(chain.model.text(0) == bounce[step]);
+		now += 10;
+	}
+
+	CHECK(!chain.display.updateMarquee(now));
+	CHECK(chain.model.errors == 0);
+}
+
+static void testMarqueeBlocking() {
+
+	Chain chain(1);
+
+	/* setTextMarquee() waits 5ms after each of the 11 steps, the wait counts as blocking */
+	chain.display.resetBusStatistics();
+	unsigned long start = micros();
+	std::chrono::steady_clock::time_point real = std::chrono::steady_clock::now();
+	chain.display.setTextMarquee("MAX6952", 5, CLASSIC, RIGHT_TO_LEFT);
+	unsigned long wall = micros() - start;
+
+	/* The stub delay() does not sleep, a busy wait would take the whole 55ms */
+	CHECK(std::chrono::steady_clock::now() - real < std::chrono::milliseconds(25));
+	CHECK(chain.model.text(0) == "2   ");
+	CHECK(chain.display.getBlockingMicros() >= 50000UL);
+	CHECK(chain.display.getBlockingMicros() <= wall);
+	CHECK(chain.display.getBusMicros(10000000UL) >= chain.display.getBlockingMicros());
+}
+
+/* The bytes of one run of the marquee */
+static std::vector<byte> runMarquee(Chain &chain, const char *text) {
+
+	unsigned long now = 0;
+
+	chain.display.setText("", LEFT);
+	chain.model.clear();
+	chain.display.startMarquee(text, 10, CLASSIC, RIGHT_TO_LEFT);
+
+	while(chain.display.updateMarquee(now)){
+		now += 10;
+	}
+
+	return chain.model.bytes;
+}
+
+static void testMarqueeCache() {
+
+	Chain chain(2);
+	std::vector<byte> built = runMarquee(chain, "HELLO");
+
+	byte cache[MARQUEE_CACHE_SIZE(2, 5)];
+
+	/* Recorded in the first run, replayed in the second one, the bytes stay the same */
+	chain.display.setMarqueeCache(cache, sizeof(cache));
+	CHECK(runMarquee(chain, "HELLO") == built);
+	CHECK(runMarquee(chain, "HELLO") == built);
+
+	/* The replay comes from the cache: a changed byte in the cache is sent */
+	CHECK(cache[0] == 1);
+	cache[2] = '#';
+	std::vector<byte> replayed = runMarquee(chain, "HELLO");
+	CHECK(replayed.size() == built.size());
+	int differences = 0;
+	for(size_t i = 0; i < built.size() && i < replayed.size(); i++){
+		if(built[i] != replayed[i]){
+			differences++;
+		}
+	}
+	CHECK(differences == 1);
+
+	/* Another text is recorded again */
+	std::vector<byte> other = runMarquee(chain, "WORLD");
+	chain.display.setMarqueeCache(NULL, 0);
+	CHECK(runMarquee(chain, "WORLD") == other);
+
+	/* A write which is queued during the run is sent, but not recorded */
+	chain.display.setMarqueeCache(cache, sizeof(cache));
+	chain.display.setText("", LEFT);
+	chain.display.startMarquee("HELLO", 10, CLASSIC, RIGHT_TO_LEFT);
+	chain.display.updateMarquee(0);
+	chain.display.queueRegister(ALL_DEVICES, 0x01, 0x33);
+	for(unsigned long now = 10; chain.display.updateMarquee(now); now += 10){
+	}
+	CHECK(chain.model.device[0].intensity10 == 0x33);
+	chain.model.device[0].intensity10 = 0x00;
+	chain.model.device[1].intensity10 = 0x00;
+	CHECK(runMarquee(chain, "HELLO") == built);
+	CHECK(chain.model.device[0].intensity10 == 0x00);
+
+	/* A small cache keeps the first steps and builds the rest */
+	chain.display.setMarqueeCache(cache, 20);
+	CHECK(runMarquee(chain, "HELLO") == built);
+	CHECK(runMarquee(chain, "HELLO") == built);
+	CHECK(chain.model.errors == 0);
+}
+
+static void testNumber() {
+
+	Chain chain(3);
+	MAX6952Region region(chain.display, 8, 4);
+
+	chain.display.setNumber(2350, 6, 2, LEFT);
+	CHECK(chain.model.text(0) == " 23.50      ");
+	chain.display.setNumber(-5L, 0, 1, LEFT);
+	CHECK(chain.model.text(0) == "-0.5        ");
+
+	/* Unsigned values above 2^31 are not turned negative */
+	chain.display.setNumber(4294967295UL);
+	CHECK(chain.model.text(0) == "  4294967295");
+	chain.display.setNumber((uint32_t)3000000000UL);
+	CHECK(chain.model.text(0) == "  3000000000");
+	chain.display.setNumber(40000U, 0, 2);
+	CHECK(chain.model.text(0) == "      400.00");
+
+	/* A counter only sends the digits which change */
+	chain.display.setNumber(3000000000UL);
+	chain.model.clear();
+	chain.display.setNumber(3000000001UL);
+	CHECK(chain.model.frames == 1);
+
+	chain.display.setText("", LEFT);
+	/* A number wider than the region is not cut */
+	region.setNumber((uint32_t)4000000000UL);
+	CHECK(chain.model.text(0) == "        ----");
+	region.setNumber(-123L, 6);
+	CHECK(chain.model.text(0) == "        -123");
+	region.setNumber(42U);
+	CHECK(chain.model.text(0) == "          42");
+	region.setNumber(7UL, 3);
+	CHECK(chain.model.text(0) == "           7");
+	CHECK(chain.model.errors == 0);
+
+	/* On one device the padding goes first, then the number becomes dashes */
+	Chain single(1);
+	single.display.setNumber(12345L);
+	CHECK(single.model.text(0) == "----");
+	single.display.setNumber(1234L, 8);
+	CHECK(single.model.text(0) == "1234");
+	single.model.clear();
+	single.display.setNumber(1235L, 8);
+	CHECK(single.model.frames == 1);
+	single.display.setNumber(2.5, 8, 2, LEFT);
+	CHECK(single.model.text(0) == "2.50");
+	CHECK(single.model.errors == 0);
+}
+
+static void testShutdown() {
+
+	/* Without shutdown(false) the first text is lit */
+	ChainModel model(2);
+	std::vector<byte> buffer(DEVICE_BUFFER_SIZE(2));
+	MAX6952 display(model, 2, &buffer[0]);
+	CHECK(model.device[0].config == 0x01);
+	CHECK(model.device[1].config == 0x01);
+	display.setText("ABCDEFGH", LEFT);
+	CHECK(model.text(0) == "ABCDEFGH");
+	CHECK(model.device[0].config == 0x01);
+	CHECK(model.device[1].config == 0x01);
+	CHECK(model.errors == 0);
+
+	Chain chain(2);
+
+	/* A device which is shut down alone stays shut down */
+	chain.display.shutdown(1, true);
+	CHECK(chain.model.device[0].config == 0x01);
+	CHECK(chain.model.device[1].config == 0x00);
+
+	chain.display.setText("ABCDEFGH", LEFT);
+	CHECK(chain.model.device[1].config == 0x00);
+
+	chain.display.setTextBlink("ABCD", BLINK_SLOW, LEFT);
+	CHECK(chain.model.device[0].config == 0x0D);
+	CHECK(chain.model.device[1].config == 0x0C);
+
+	chain.display.setText("ABCDEFGH", LEFT);
+	CHECK(chain.model.device[0].config == 0x05);
+	CHECK(chain.model.device[1].config == 0x04);
+
+	chain.display.clearDisplay();
+	CHECK(chain.model.device[0].config == 0x05);
+	CHECK(chain.model.device[1].config == 0x04);
+	CHECK(chain.model.text(0) == "        ");
+
+	chain.display.shutdown(1, false);
+	CHECK(chain.model.device[1].config == 0x05);
+	CHECK(chain.model.errors == 0);
+}
+
+static void testNoHeap() {
+
+	Chain chain(2);
+	MAX6952Region region(chain.display, 4, 4);
+	byte cache[MARQUEE_CACHE_SIZE(2, 5)];
+	unsigned long now = 0;
+
+	/* The model keeps the bytes and the order in vectors, they must not grow while counting */
+	chain.model.bytes.reserve(1 << 16);
+	chain.model.order.reserve(1 << 16);
+	chain.display.setMarqueeCache(cache, sizeof(cache));
+
+	allocations = 0;
+
+	chain.display.setText("ABCDEFGH", LEFT);
+	chain.display.setText("ABCD", 4, RIGHT);
+	chain.display.setNumber(1234L, 6, 2);
+	chain.display.setNumber(3000000000UL);
+	chain.display.setNumber(-3.25, 6, 2);
+	chain.display.setTextBlink("ABCD", "EFGH", BLINK_FAST, LEFT);
+	chain.display.setDigitBlink(1, true);
+	chain.display.setIntensity(7);
+	chain.display.fadeIntensity(ALL_DEVICES, 0, 15, 100);
+	while(chain.display.updateFade(now)){
+		now += 10;
+	}
+
+	for(int run = 0; run < 2; run++){
+		chain.display.startMarquee("HELLO", 10, CLASSIC, RIGHT_TO_LEFT);
+		while(chain.display.updateMarquee(now)){
+			now += 10;
+		}
+	}
+
+	chain.display.setDoubleBuffer(true);
+	chain.display.setText("PAGE", CENTER);
+	chain.display.present();
+	while(chain.display.updatePresent(now)){
+		now += 100;
+	}
+	chain.display.setDoubleBuffer(false);
+
+	region.setText("RGN", LEFT);
+	region.setNumber(42);
+	region.startMarquee("RUN", 10, CLASSIC, LEFT_TO_RIGHT);
+	while(region.updateMarquee(now)){
+		now += 10;
+	}
+
+	CHECK(allocations == 0);
+
+	/* The String overload of startMarquee() copies the text, as documented */
+	String text("A TEXT WHICH DOES NOT FIT INTO A SHORT STRING");
+	allocations = 0;
+	chain.display.startMarquee(text, 10, CLASSIC, RIGHT_TO_LEFT);
+	CHECK(allocations > 0);
+	allocations = 0;
+	chain.display.startMarquee(text, 10, CLASSIC, RIGHT_TO_LEFT);
+	CHECK(allocations == 0);
+	CHECK(chain.model.errors == 0);
+
+	/* The buffer inside MAX6952Static is not allocated and can not be shared by a copy */
+	static_assert(!std::is_copy_constructible<MAX6952Static<2> >::value, "MAX6952Static must not be copied");
+	static_assert(!std::is_copy_assignable<MAX6952Static<2> >::value, "MAX6952Static must not be assigned");
+
+	ChainModel model(2);
+	model.bytes.reserve(1 << 16);
+	model.order.reserve(1 << 16);
+	allocations = 0;
+	MAX6952Static<2> display(model);
+	display.setText("STATIC", LEFT);
+	CHECK(allocations == 0);
+	CHECK(model.text(0) == "STATIC  ");
+	CHECK(model.errors == 0);
+}
+
+static void testGroup() {
+
+	Chain left(1);
+	Chain right(1);
+	MAX6952 *chains[] = { &left.display, &right.display };
+	MAX6952Group group(chains, 2);
+
+	group.setText("ABCDEFGH", LEFT);
+	CHECK(left.model.text(0) == "ABCD");
+	CHECK(right.model.text(0) == "EFGH");
+	CHECK(left.model.frames == 4 && right.model.frames == 4);
+
+	/* A chain in double buffer mode waits for present() */
+	right.display.setDoubleBuffer(true);
+	left.model.clear();
+	right.model.clear();
+	group.setText("ABCDWXYZ", LEFT);
+	CHECK(left.model.frames == 0);
+	CHECK(right.model.frames == 0);
+	right.display.present();
+	CHECK(right.model.text(1) == "WXYZ");
+	CHECK(right.display.updatePresent(0));
+	CHECK(!right.display.updatePresent(1000));
+	CHECK(right.model.text(0) == "WXYZ");
+	right.display.setDoubleBuffer(false);
+
+	/* A chain with a refresh interval waits for service() */
+	left.display.setRefreshInterval(16);
+	left.model.clear();
+	right.model.clear();
+	group.setText("1234WXY5", LEFT);
+	CHECK(left.model.frames == 0);
+	CHECK(right.model.frames == 1);
+	left.display.service(0);
+	CHECK(left.model.text(0) == "1234");
+	CHECK(left.model.errors == 0 && right.model.errors == 0);
+}
+
+static void testGroupChains() {
+
+	Chain left(1);
+	Chain right(2);
+	MAX6952 *chains[] = { &left.display, &right.display };
+	MAX6952Group group(chains, 2);
+
+	CHECK(group.getMaxTextLength() == 12);
+
+	/* The text is aligned in the 12 characters of both chains */
+	group.setText("HELLO", RIGHT);
+	CHECK(left.model.text(0) == "    ");
+	CHECK(right.model.text(0) == "   HELLO");
+
+	group.setText("HELLO", CENTER);
+	CHECK(left.model.text(0) == "   H");
+	CHECK(right.model.text(0) == "ELLO    ");
+	CHECK(right.model.text(1) == "ELLO    ");
+
+	/* One frame of each chain in turn, the longer queue ends alone */
+	left.model.clear();
+	right.model.clear();
+	group.setText("ABCDEFGHIJ", LEFT);
+	CHECK(left.model.text(0) == "ABCD");
+	CHECK(right.model.text(0) == "EFGHIJ  ");
+	CHECK(left.model.frames == 4 && right.model.frames == 3);
+
+	for(size_t k = 0; k < right.model.order.size(); k++){
+		CHECK(left.model.order[k] < right.model.order[k]);
+		CHECK(right.model.order[k] < left.model.order[k + 1]);
+	}
+
+	left.model.clear();
+	right.model.clear();
+	group.setText("A", LEFT);
+	CHECK(left.model.frames == 3);
+	CHECK(right.model.frames == 4);
+	CHECK(left.model.order[0] < right.model.order[0] && right.model.order[0] < left.model.order[1]);
+	CHECK(left.model.order[2] < right.model.order[2] && right.model.order[2] < right.model.order[3]);
+
+	/* A text longer than all chains is cut at the end */
+	group.setText("0123456789ABCDEF", CENTER);
+	CHECK(left.model.text(0) == "0123");
+	CHECK(right.model.text(0) == "456789AB");
+	CHECK(left.model.errors == 0 && right.model.errors == 0);
+}
+
+static void testRegionDoubleBuffer() {
+
+	Chain chain(2);
+	MAX6952Region label(chain.display, 0, 4);
+	MAX6952Region value(chain.display, 4, 4);
+
+	label.setText("OLD", LEFT);
+	value.setText("TEXT", LEFT);
+	CHECK(chain.model.text(0) == "OLD TEXT");
+
+	/* In double buffer mode the regions only draw */
+	chain.display.setDoubleBuffer(true);
+	chain.model.clear();
+	label.setText("NEW", LEFT);
+	value.setNumber(42);
+	CHECK(chain.model.frames == 0);
+
+	value.startMarquee("AB", 10, CLASSIC, RIGHT_TO_LEFT);
+	CHECK(value.updateMarquee(0));
+	CHECK(value.updateMarquee(10));
+	CHECK(chain.model.frames == 0);
+	value.stopMarquee();
+
+	chain.display.present();
+	CHECK(chain.model.text(0) == "OLD TEXT");
+	CHECK(chain.model.text(1) == "NEW    A");
+	CHECK(!chain.display.updatePresent(0) || !chain.display.updatePresent(1000));
+	CHECK(chain.model.text(0) == "NEW    A");
+	CHECK(chain.model.device[0].config == 0x01);
+
+	/* Without double buffer a running flip is finished before the region changes */
+	chain.display.setDoubleBuffer(false);
+	chain.display.setChar(0, 'X');
+	chain.display.present();
+	CHECK(chain.display.isPresenting());
+	label.setText("LBL", LEFT);
+	CHECK(!chain.display.isPresenting());
+	CHECK(chain.model.text(0) == "LBL    A");
+	CHECK(chain.model.text(1) == "LBL    A");
+	CHECK(chain.model.device[0].config == 0x01);
+	CHECK(chain.model.device[1].config == 0x01);
+	CHECK(chain.model.errors == 0);
+}
+
+static void testHardwareSPI() {
+
+	ChainModel model(2);
+	SPIProbe probe(model, 5);
+	std::vector<byte> buffer(DEVICE_BUFFER_SIZE(2));
+
+	/* Every frame is one transaction with CS low around its bytes */
+	MAX6952 display(23, 18, 5, 2, &buffer[0]);
+	CHECK(model.frames > 0);
+	CHECK(probe.selects == model.frames);
+	CHECK(probe.deselects == model.frames);
+	CHECK(probe.transactionCount == model.frames);
+	CHECK(probe.transactions == 0);
+	CHECK(probe.clock == 10000000UL);
+
+	display.setText("ABCDEFGH", LEFT);
+	CHECK(model.text(0) == "ABCDEFGH");
+	CHECK(model.text(1) == "ABCDEFGH");
+	CHECK(model.device[0].config == 0x01);
+
+	/* The clock is limited to what the MAX6952 can take */
+	display.setClock(40000000UL);
+	display.setChar(0, 'Z');
+	display.flush();
+	CHECK(probe.clock == 26000000UL);
+	CHECK(model.text(0) == "ZBCDEFGH");
+
+	CHECK(probe.transactionCount == model.frames);
+	CHECK(probe.errors == 0);
+	CHECK(model.errors == 0);
+}
+
+static void testUserFont() {
+
+	Chain chain(2);
+	byte glyphs[15];
+
+	for(int i = 0; i < 15; i++){
+		glyphs[i] = (byte)((i * 37) | ((i & 1) ? 0x80 : 0x00));
+	}
+
+	/* One pointer for the run of slots, then 5 frames per glyph for both devices */
+	CHECK(chain.display.setUserFont(ALL_DEVICES, 2, glyphs, 3) == 6);
+	CHECK(chain.model.frames == 1 + 5 * 3);
+	CHECK(std::vector<byte>(chain.model.bytes.begin(), chain.model.bytes.begin() + 4) == bytes({0x05, 0x8A, 0x05, 0x8A}));
+
+	for(int j = 0; j < 2; j++){
+		for(int i = 0; i < 15; i++){
+			CHECK(chain.model.device[j].font[10 + i] == (glyphs[i] & 0x7F));
+		}
+	}
+
+	/* With the cache a glyph the devices have is not sent again */
+	std::vector<byte> cache(FONT_CACHE_SIZE(2));
+	chain.display.setFontCache(&cache[0]);
+	chain.model.clear();
+	CHECK(chain.display.setUserFont(ALL_DEVICES, 2, glyphs, 3) == 6);
+	CHECK(chain.model.frames == 16);
+
+	chain.model.clear();
+	CHECK(chain.display.setUserFont(ALL_DEVICES, 2, glyphs, 3) == 0);
+	CHECK(chain.model.frames == 0);
+
+	/* One changed glyph is sent alone, with its own pointer */
+	glyphs[5] = 0x2A;
+	chain.model.clear();
+	CHECK(chain.display.setUserFont(ALL_DEVICES, 2, glyphs, 3) == 2);
+	CHECK(chain.model.frames == 6);
+	CHECK(chain.model.device[0].font[15] == 0x2A);
+
+	/* After a power loss everything is sent again */
+	chain.display.invalidateUserFont();
+	chain.model.clear();
+	CHECK(chain.display.setUserFont(ALL_DEVICES, 2, glyphs, 3) == 6);
+	CHECK(chain.model.frames == 16);
+
+	/* A glyph for one device, the other one gets NOOPs. The last device comes first in a frame. */
+	const byte glyph[5] = {0x11, 0x22, 0x33, 0x44, 0x55};
+	chain.model.clear();
+	CHECK(chain.display.setUserFont(1, 0, glyph, 1) == 1);
+	CHECK(chain.model.bytes == bytes({
+		0x05, 0x80, 0x00, 0x00,
+		0x05, 0x11, 0x00, 0x00,
+		0x05, 0x22, 0x00, 0x00,
+		0x05, 0x33, 0x00, 0x00,
+		0x05, 0x44, 0x00, 0x00,
+		0x05, 0x55, 0x00, 0x00}));
+	CHECK(chain.model.device[0].font[0] == 0x00);
+	CHECK(chain.model.device[1].font[0] == 0x11);
+
+	/* The next slot on the same device needs no pointer */
+	chain.model.clear();
+	chain.display.setUserFont(1, 1, glyph, 1);
+	CHECK(chain.model.frames == 5);
+	CHECK(chain.model.device[1].font[5] == 0x11);
+	CHECK(chain.model.errors == 0);
+
+	chain.display.setFontCache(NULL);
+}
+
+/* The columns of a character of the ROM font, or of a slot in the font RAM of the model */
+static std::vector<byte> digitColumns(const DeviceModel &device, byte c) {
+
+	std::vector<byte> columns(5, 0x00);
+
+	for(int i = 0; i < 5; i++){
+		if(c < 0x10 || (c >= 0x80 && c < 0x88)){
+			int slot = (c < 0x10) ? c : c - 0x80 + 16;
+			columns[i] = device.font[(slot * 5) + i];
+		} else if(c >= FONT_FIRST_CHAR && c <= FONT_LAST_CHAR){
+			columns[i] = MAX6952_FONT[((c - FONT_FIRST_CHAR) * 5) + i];
+		}
+	}
+
+	return columns;
+}
+
+/* Column of the text row of the smooth marquee, 5 font columns and a blank per character */
+static byte textColumn(const char *text, int column) {
+
+	int length = strlen(text);
+
+	if(column < 0 || column >= length * 6 || column % 6 == 5){
+		return 0x00;
+	}
+
+	return MAX6952_FONT[((text[column / 6] - FONT_FIRST_CHAR) * 5) + (column % 6)];
+}
+
+/* The display shows the columns of the text row from column first on */
+static bool showsWindow(ChainModel &model, const char *text, int devices, int first) {
+
+	for(int position = 0; position < devices * 4; position++){
+
+		const DeviceModel &device = model.device[position / 4];
+		std::vector<byte> columns = digitColumns(device, device.plane0[position % 4]);
+
+		for(int i = 0; i < 5; i++){
+			if(columns[i] != textColumn(text, first + (position * 6) + i)){
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/* Glyphs a device got in the recorded frames, 5 columns each */
+static int glyphUploads(ChainModel &model, int devices, int device) {
+
+	int columns = 0;
+
+	for(size_t f = 0; f + (devices * 2) <= model.bytes.size(); f += devices * 2){
+
+		byte addr = model.bytes[f + ((devices - 1 - device) * 2)];
+		byte data = model.bytes[f + ((devices - 1 - device) * 2) + 1];
+
+		if(addr == 0x05 && !(data & 0x80)){
+			columns++;
+		}
+	}
+
+	return columns / 5;
+}
+
+/* Runs a smooth marquee, returns the glyphs uploaded to all devices */
+static int runSmooth(Chain &chain, int devices, const char *text, int budget) {
+
+	int total = 0;
+	int step = 0;
+	unsigned long now = 0;
+
+	chain.display.setSmoothScroll(true, budget);
+	chain.display.startMarquee(text, 10, CLASSIC, RIGHT_TO_LEFT);
+
+	while(true){
+
+		std::vector<DeviceModel> before = chain.model.device;
+
+		chain.model.clear();
+
+		if(!chain.display.updateMarquee(now)){
+			break;
+		}
+
+		now += 10;
+
+		for(int j = 0; j < devices; j++){
+
+			int uploads = glyphUploads(chain.model, devices, j);
+
+			/* Never more glyphs than the budget in one step */
+			CHECK(uploads <= budget);
+			total += uploads;
+
+			/* A slot which was on screen before the step is not overwritten */
+			for(int digit = 0; digit < 4; digit++){
+
+				byte c = before[j].plane0[digit];
+
+				if(c < 0x10 || (c >= 0x80 && c < 0x88)){
+					CHECK(digitColumns(before[j], c) == digitColumns(chain.model.device[j], c));
+				}
+			}
+		}
+
+		/* With the full budget every step shows the text row one column further,
+		 * it starts with the blank padding of the whole display */
+		if(budget == 4){
+			CHECK(showsWindow(chain.model, text, devices, step - (devices * 4 * 6)));
+		}
+
+		step++;
+	}
+
+	CHECK(step == (devices * 4 + (int)strlen(text)) * 6);
+	chain.display.setSmoothScroll(false);
+	CHECK(chain.model.errors == 0);
+
+	return total;
+}
+
+static void testSmoothScroll() {
+
+	Chain chain(2);
+	std::vector<byte> cache(FONT_CACHE_SIZE(2));
+
+	/* Without the cache every shifted glyph is uploaded */
+	int uncached = runSmooth(chain, 2, "HELLO", 4);
+	CHECK(uncached > 0);
+
+	/* With the cache a glyph in the font RAM is used again */
+	chain.display.setFontCache(&cache[0]);
+	CHECK(runSmooth(chain, 2, "HELLO", 4) < uncached);
+
+	/* A device needs each of the 3 * 5 shifted glyphs of "====" once, also
+	 * when several of its digits show it in the same step */
+	chain.display.invalidateUserFont();
+	CHECK(runSmooth(chain, 2, "====", 4) <= 2 * 3 * 5);
+
+	/* A short text fits into the font RAM, the second run uploads nothing */
+	chain.display.invalidateUserFont();
+	CHECK(runSmooth(chain, 2, "AB", 4) <= 2 * 3 * 5);
+	CHECK(runSmooth(chain, 2, "AB", 4) == 0);
+
+	/* A small budget shows whole characters where the glyphs do not fit */
+	chain.display.invalidateUserFont();
+	CHECK(runSmooth(chain, 2, "MAX6952", 1) > 0);
+
+	chain.display.setFontCache(NULL);
+}
+
+static void testScheduler() {
+
+	Chain chain(1);
+	unsigned long coalesced = chain.display.getCoalescedCount();
+	unsigned long sent = 0;
+
+	/* A burst of updates every 2ms gives one refresh per interval of 16ms */
+	chain.display.setRefreshInterval(16);
+
+	for(unsigned long now = 0; now <= 16; now += 2){
+
+		unsigned long frames = chain.model.frames;
+
+		chain.display.setNumber((long)now);
+		CHECK(chain.model.frames == frames);
+		chain.display.service(now);
+
+		if(chain.model.frames != frames){
+			sent++;
+			CHECK(now == 0 || now == 16);
+		}
+	}
+
+	CHECK(sent == 2);
+	CHECK(chain.model.text(0) == "  16");
+	CHECK(chain.display.getCoalescedCount() - coalesced == 7);
+
+	/* The digits of writeDisplay() do not downgrade a waiting text, the blink goes off */
+	chain.display.setRefreshInterval(0);
+	chain.display.setTextBlink("ABCD", "WXYZ", BLINK_SLOW, LEFT);
+	CHECK(chain.model.device[0].config == 0x0D);
+	chain.display.setRefreshInterval(16);
+	chain.display.setText("TEXT", LEFT);
+	char digits[] = "DISP";
+	chain.display.writeDisplay(digits);
+	CHECK(chain.model.device[0].config == 0x0D);
+	CHECK(!chain.display.service(100));
+	CHECK(chain.model.text(0) == "DISP");
+	CHECK(chain.model.text(1) == "DISP");
+	CHECK(chain.model.device[0].config == 0x05);
+
+	/* Switching the scheduler off sends the waiting update */
+	chain.display.setNumber(42L);
+	CHECK(chain.model.text(0) == "DISP");
+	chain.display.setRefreshInterval(0);
+	CHECK(chain.model.text(0) == "  42");
+	CHECK(!chain.display.service(200));
+	CHECK(chain.model.errors == 0);
+}
+
+typedef void (*TestFunction)();
+
+static const struct {
+	const char *name;
+	TestFunction function;
+} tests[] = {
+	{"ShadowFlush", testShadowFlush},
+	{"QueuePacking", testQueuePacking},
+	{"Blink", testBlink},
+	{"Present", testPresent},
+	{"Marquee", testMarquee},
+	{"MarqueeBlocking", testMarqueeBlocking},
+	{"MarqueeCache", testMarqueeCache},
+	{"Number", testNumber},
+	{"Shutdown", testShutdown},
+	{"NoHeap", testNoHeap},
+	{"Group", testGroup},
+	{"GroupChains", testGroupChains},
+	{"RegionDoubleBuffer", testRegionDoubleBuffer},
+	{"HardwareSPI", testHardwareSPI},
+	{"UserFont", testUserFont},
+	{"SmoothScroll", testSmoothScroll},
+	{"Scheduler", testScheduler},
+};
+
+int main(int argc, char **argv) {
+
+	int run = 0;
+
+	for(size_t t = 0; t < sizeof(tests) / sizeof(tests[0]); t++){
+
+		if(argc > 1 && strcmp(argv[1], tests[t].name) != 0){
+			continue;
+		}
+
+		int before = failures;
+
+		tests[t].function();
+		run++;
+
+		printf("%s %s\n", (failures == before) ? "PASS" : "FAIL", tests[t].name);
+	}
+
+	if(run == 0){
+		printf("No test %s\n", argv[1]);
+		return 1;
+	}
+
+	return (failures == 0) ? 0 : 1;
+}
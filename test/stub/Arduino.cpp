@@ -0,0 +1,98 @@
+/*
+ *    Arduino.cpp - The Arduino core functions for building on a PC.
+ */
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <stdio.h>
+#include <chrono>
+
+HardwareSerial Serial;
+SPIClass SPI;
+
+static PinListener *pinListener = NULL;
+
+/* Time added by delay() */
+static unsigned long long skipped = 0;
+
+static unsigned long long clockMicros() {
+
+	static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() + skipped;
+}
+
+unsigned long millis() {
+	return (unsigned long)(clockMicros() / 1000ULL);
+}
+
+unsigned long micros() {
+	return (unsigned long)clockMicros();
+}
+
+void delay(unsigned long ms) {
+	skipped += ms * 1000ULL;
+}
+
+void delayMicroseconds(unsigned int us) {
+	skipped += us;
+}
+
+void yield() {
+}
+
+void pinMode(uint8_t, uint8_t) {
+}
+
+void setPinListener(PinListener *listener) {
+	pinListener = listener;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+
+	if(pinListener != NULL){
+		pinListener->pinWritten(pin, value);
+	}
+}
+
+void shiftOut(uint8_t, uint8_t, uint8_t, uint8_t) {
+}
+
+void HardwareSerial::begin(unsigned long) {
+}
+
+void HardwareSerial::print(const char *value) {
+	fputs(value, stdout);
+}
+
+void HardwareSerial::print(const String &value) {
+	fputs(value.c_str(), stdout);
+}
+
+void HardwareSerial::print(char value) {
+	putchar(value);
+}
+
+void HardwareSerial::print(int value) {
+	printf("%d", value);
+}
+
+void HardwareSerial::print(unsigned int value) {
+	printf("%u", value);
+}
+
+void HardwareSerial::print(long value) {
+	printf("%ld", value);
+}
+
+void HardwareSerial::print(unsigned long value) {
+	printf("%lu", value);
+}
+
+void HardwareSerial::print(double value) {
+	printf("%.2f", value);
+}
+
+void HardwareSerial::println() {
+	putchar('\n');
+}
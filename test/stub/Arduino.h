@@ -0,0 +1,85 @@
+/*
+ *    Arduino.h - The part of the Arduino core the MAX6952 library uses,
+ *    for building the library and its tests on a PC.
+ *
+ *    The time is the clock of the PC. delay() does not wait, it moves
+ *    the time forward, so the tests run at full speed. A test can watch
+ *    the pins with a PinListener.
+ */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH		1
+#define LOW			0
+#define INPUT		0
+#define OUTPUT		1
+#define LSBFIRST	0
+#define MSBFIRST	1
+
+#define PROGMEM
+#define pgm_read_byte(address)	(*(const uint8_t *)(address))
+
+class PinListener {
+    public:
+        virtual void pinWritten(uint8_t pin, uint8_t value) = 0;
+};
+
+/* Every digitalWrite() goes to the listener, NULL for none */
+void setPinListener(PinListener *listener);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t value);
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+
+class String {
+    private :
+        std::string text;
+
+    public:
+        String(const char *value = "") : text(value) {}
+        String(const String &value) : text(value.text) {}
+
+        String &operator=(const String &value) { text = value.text; return *this; }
+        String &operator=(const char *value) { text = value; return *this; }
+
+        const char *c_str() const { return text.c_str(); }
+        unsigned int length() const { return text.length(); }
+};
+
+
+class HardwareSerial {
+    public:
+        void begin(unsigned long baud);
+
+        void print(const char *value);
+        void print(const String &value);
+        void print(char value);
+        void print(int value);
+        void print(unsigned int value);
+        void print(long value);
+        void print(unsigned long value);
+        void print(double value);
+
+        template<typename T> void println(T value) { print(value); println(); }
+        void println();
+};
+
+extern HardwareSerial Serial;
+
+#endif	//Arduino.h
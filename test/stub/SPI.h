@@ -0,0 +1,45 @@
+/*
+ *    SPI.h - SPI of the Arduino core for building on a PC, nothing is sent.
+ *    A test sees the transactions and the bytes with an SPIListener, or
+ *    uses a MAX6952Transport to see the frames.
+ */
+
+#ifndef SPI_h
+#define SPI_h
+
+#include <Arduino.h>
+
+#define SPI_MODE0	0x00
+
+class SPISettings {
+    public:
+        uint32_t clock;
+
+        SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) : clock(clock) { (void)bitOrder; (void)dataMode; }
+};
+
+class SPIListener {
+    public:
+        virtual void beginTransaction(uint32_t clock) = 0;
+        virtual void endTransaction() = 0;
+        virtual void transfer(const uint8_t *data, size_t count) = 0;
+};
+
+class SPIClass {
+    public:
+        /* Gets every call on the bus, NULL for none */
+        SPIListener *listener;
+
+        SPIClass() : listener(NULL) {}
+
+        void begin() {}
+        void beginTransaction(SPISettings settings) { if(listener) listener->beginTransaction(settings.clock); }
+        void endTransaction() { if(listener) listener->endTransaction(); }
+        uint8_t transfer(uint8_t data) { if(listener) listener->transfer(&data, 1); return data; }
+        void transfer(void *buffer, size_t count) { if(listener) listener->transfer((const uint8_t *)buffer, count); }
+        void writeBytes(const uint8_t *data, uint32_t size) { if(listener) listener->transfer(data, size); }
+};
+
+extern SPIClass SPI;
+
+#endif	//SPI.h